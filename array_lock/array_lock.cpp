@@ -0,0 +1,30 @@
+// This program benchmarks an array-based queue lock in C++
+// Optimizations:
+//  1.) Ticket-style fairness (FIFO)
+//  2.) Each ticket spins on its own padded slot
+// Compared against the ticket lock (one shared serving word) and the MCS
+// lock (one node per waiter)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/array_lock.h"
+#include "../include/spinlocks/mcs_lock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+using bench::pooled_lock_benchmark;
+
+BENCHMARK_TEMPLATE(pooled_lock_benchmark, spinlocks::ArrayLock<>)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(pooled_lock_benchmark, spinlocks::TicketLock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(pooled_lock_benchmark, spinlocks::MCSLock)
+    ->Apply(bench::pool_sweep);
+
+// Workload Benchmark
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::ArrayLock<>)
+    ->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+// This program benchmarks every lock under an identical workload
+// Writes a single JSON report (all_locks.json) so runs can be compared
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "../include/spinlocks/array_lock.h"
+#include "../include/spinlocks/clh_lock.h"
+#include "../include/spinlocks/cohort_lock.h"
+#include "../include/spinlocks/futex_lock.h"
+#include "../include/spinlocks/mcs_lock.h"
+#include "../include/spinlocks/rw_spinlock.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
+#include "harness.h"
+
+using bench::latency_benchmark;
+using bench::lock_benchmark;
+using bench::pooled_lock_benchmark;
+using bench::workload_benchmark;
+
+// Register a lock with every harness mode:
+//  1.) Threads spawned every iteration
+//  2.) Persistent pool of pinned threads (only the lock loop is timed)
+//  3.) Same pool, recording tail latency and fairness
+//  4.) Same pool, with more realistic critical sections and think time
+#define LOCK_BENCHMARK(Lock)                                                 \
+  BENCHMARK_TEMPLATE(lock_benchmark, Lock)->Apply(bench::thread_sweep);      \
+  BENCHMARK_TEMPLATE(pooled_lock_benchmark, Lock)->Apply(bench::pool_sweep); \
+  BENCHMARK_TEMPLATE(latency_benchmark, Lock)->Apply(bench::pool_sweep);     \
+  BENCHMARK_TEMPLATE(workload_benchmark, Lock)->Apply(bench::workload_sweep)
+
+// Our spinlocks
+LOCK_BENCHMARK(spinlocks::NaiveSpinlock);
+LOCK_BENCHMARK(spinlocks::LocalSpinlock);
+LOCK_BENCHMARK(spinlocks::ActiveBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::PassiveBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::ExpBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::RandomBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::AdaptiveBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::TimedBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::MonitorSpinlock);
+LOCK_BENCHMARK(spinlocks::AcqRelExpBackoffSpinlock);
+LOCK_BENCHMARK(spinlocks::TicketLock);
+LOCK_BENCHMARK(spinlocks::ProportionalTicketLock<>);
+LOCK_BENCHMARK(spinlocks::ArrayLock<>);
+LOCK_BENCHMARK(spinlocks::MCSLock);
+LOCK_BENCHMARK(spinlocks::AcqRelMCSLock);
+LOCK_BENCHMARK(spinlocks::AnonymousCLHLock);
+LOCK_BENCHMARK(spinlocks::CohortLock<>);
+LOCK_BENCHMARK(spinlocks::FutexLock<>);
+
+// State-of-the-art locks
+LOCK_BENCHMARK(bench::PthreadSpinlock);
+LOCK_BENCHMARK(bench::PthreadMutex);
+LOCK_BENCHMARK(std::mutex);
+
+// Read-mostly workloads
+using bench::rw_benchmark;
+BENCHMARK_TEMPLATE(rw_benchmark, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(rw_benchmark, spinlocks::RWSpinlock<>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(rw_benchmark, spinlocks::ScalableRWSpinlock<>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(rw_benchmark, std::shared_mutex)->Apply(bench::rw_sweep);
+
+// Lock-free baseline
+BENCHMARK(bench::atomic_benchmark)->Apply(bench::thread_sweep);
+BENCHMARK(bench::pooled_atomic_benchmark)->Apply(bench::pool_sweep);
+
+int main(int argc, char **argv) {
+  // Default to writing a JSON report unless the user picked an output file
+  std::vector<char *> args(argv, argv + argc);
+  std::string out = "--benchmark_out=all_locks.json";
+  std::string out_format = "--benchmark_out_format=json";
+  bool has_out = false;
+  for (int i = 1; i < argc; i++)
+    if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) has_out = true;
+  if (!has_out) {
+    args.push_back(out.data());
+    args.push_back(out_format.data());
+  }
+
+  // Run everything
+  int num_args = static_cast<int>(args.size());
+  benchmark::Initialize(&num_args, args.data());
+  if (benchmark::ReportUnrecognizedArguments(num_args, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
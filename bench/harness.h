@@ -0,0 +1,674 @@
+// This header contains the benchmark harness shared by every lock benchmark
+// Every lock runs the same workload over the same thread sweep
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <pthread.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../include/spinlocks/cache_line.h"
+#include "../include/spinlocks/histogram.h"
+#include "../include/spinlocks/pause.h"
+#include "perf_counters.h"
+#include "topology.h"
+
+namespace bench {
+
+// Number of times each thread increments the shared value
+constexpr int kIncrements = 100000;
+
+// pthread_spinlock_t with the same interface as our locks
+class PthreadSpinlock {
+ private:
+  pthread_spinlock_t sl;
+
+ public:
+  PthreadSpinlock() { pthread_spin_init(&sl, PTHREAD_PROCESS_PRIVATE); }
+  ~PthreadSpinlock() { pthread_spin_destroy(&sl); }
+  void lock() { pthread_spin_lock(&sl); }
+  void unlock() { pthread_spin_unlock(&sl); }
+};
+
+// pthread_mutex_t with the same interface as our locks
+class PthreadMutex {
+ private:
+  pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+
+ public:
+  ~PthreadMutex() { pthread_mutex_destroy(&m); }
+  void lock() { pthread_mutex_lock(&m); }
+  void unlock() { pthread_mutex_unlock(&m); }
+};
+
+// Queue locks (e.g., MCS) need a node for each acquisition
+// Those locks provide a Guard that keeps the node on the stack
+template <typename Lock, typename = void>
+struct needs_node : std::false_type {};
+template <typename Lock>
+struct needs_node<Lock, std::void_t<typename Lock::Node>> : std::true_type {};
+
+// Run fn holding the lock
+template <typename Lock, typename F>
+void locked(Lock &s, F fn) {
+  if constexpr (needs_node<Lock>::value) {
+    typename Lock::Guard g(s);
+    fn();
+  } else {
+    s.lock();
+    fn();
+    s.unlock();
+  }
+}
+
+// Increment val once each time the lock is acquired
+template <typename Lock>
+void inc(Lock &s, std::int64_t &val) {
+  for (int i = 0; i < kIncrements; i++) locked(s, [&] { val++; });
+}
+
+// Workload for a lock benchmark
+// Each thread still acquires the lock kIncrements times, but can:
+//  1.) Do some work while holding the lock
+//  2.) Write several cache lines under the lock (real critical sections
+//      rarely touch just one)
+//  3.) Do some work between acquisitions (think time)
+//  4.) Arrive in bursts: take the lock burst times back to back, then think
+//      for burst times as long (same average load as steady arrivals)
+// Work is measured in iterations of an empty loop (about a cycle each)
+struct Workload {
+  int cs_work = 0;
+  int cs_lines = 1;
+  int think_work = 0;
+  int burst = 1;
+};
+
+// Most cache lines a Workload can write under the lock
+constexpr int kMaxLines = 64;
+
+// Data protected by the lock (one value per cache line)
+struct SharedLines {
+  struct alignas(spinlocks::kCacheLineSize) Line {
+    std::int64_t value = 0;
+  };
+  Line lines[kMaxLines];
+};
+
+// Burn some iterations without touching memory
+inline void work(int iters) {
+  for (int i = 0; i < iters; i++) benchmark::DoNotOptimize(i);
+}
+
+// Take the lock kIncrements times with the given workload
+template <typename Lock>
+void run_workload(Lock &s, SharedLines &data, const Workload &w) {
+  for (int i = 0; i < kIncrements; i++) {
+    locked(s, [&] {
+      work(w.cs_work);
+      for (int l = 0; l < w.cs_lines; l++) data.lines[l].value++;
+    });
+
+    // Think once per burst (steady arrivals have a burst of 1)
+    if ((i + 1) % w.burst == 0) work(w.think_work * w.burst);
+  }
+}
+
+// How long one thread waited for each acquisition (rdtsc)
+// Padded so threads never share a line while recording
+struct alignas(spinlocks::kCacheLineSize) ThreadLatency {
+  spinlocks::Histogram wait_cycles;
+};
+
+// Who got the lock while every thread was still competing for it
+// Once the first thread finishes its increments the rest face less
+// contention, so we stop counting there (otherwise every thread would
+// always end up with exactly kIncrements acquisitions)
+// Only touched while holding the lock
+class FairnessTracker {
+ private:
+  // Acquisitions by each thread
+  std::vector<std::uint64_t> shares;
+
+  // Longest run of back-to-back acquisitions by one thread
+  int last_owner = -1;
+  std::uint64_t run = 0;
+  std::uint64_t longest = 0;
+
+  // Cleared when the first thread finishes this round
+  bool contended = true;
+
+  // Fraction of every acquisition that n makes up
+  double share(std::uint64_t n) const {
+    double total = 0;
+    for (auto x : shares) total += x;
+    return total == 0 ? 0 : n / total;
+  }
+
+ public:
+  explicit FairnessTracker(int num_threads) : shares(num_threads) {}
+
+  // Called before the workers are released for a round
+  void start_round() {
+    contended = true;
+    last_owner = -1;
+    run = 0;
+  }
+
+  // Called holding the lock (last is true on the thread's final acquisition)
+  void acquired(int tid, bool last) {
+    if (!contended) return;
+    shares[tid]++;
+    run = tid == last_owner ? run + 1 : 1;
+    last_owner = tid;
+    longest = std::max(longest, run);
+    if (last) contended = false;
+  }
+
+  // Jain's fairness index: 1 when every thread got the same share, and
+  // 1/num_threads when one thread got every acquisition
+  double jain_index() const {
+    double sum = 0;
+    double sum_squares = 0;
+    for (auto n : shares) {
+      sum += n;
+      sum_squares += static_cast<double>(n) * n;
+    }
+    if (sum_squares == 0) return 1;
+    return sum * sum / (shares.size() * sum_squares);
+  }
+
+  // Smallest and largest fraction of acquisitions that went to one thread
+  double min_share() const {
+    return share(*std::min_element(shares.begin(), shares.end()));
+  }
+  double max_share() const {
+    return share(*std::max_element(shares.begin(), shares.end()));
+  }
+
+  std::uint64_t longest_run() const { return longest; }
+};
+
+// Increment val under the lock, recording the wait for each acquisition
+template <typename Lock>
+void timed_inc(Lock &s, std::int64_t &val, ThreadLatency &latency,
+               FairnessTracker &fairness, int tid) {
+  for (int i = 0; i < kIncrements; i++) {
+    auto start = __rdtsc();
+    locked(s, [&] {
+      latency.wait_cycles.record(__rdtsc() - start);
+      fairness.acquired(tid, i + 1 == kIncrements);
+      val++;
+    });
+  }
+}
+
+// Reader-writer locks have lock_shared()/unlock_shared()
+template <typename Lock, typename = void>
+struct has_shared : std::false_type {};
+template <typename Lock>
+struct has_shared<Lock,
+                  std::void_t<decltype(std::declval<Lock &>().lock_shared())>>
+    : std::true_type {};
+
+// Read val (read_pct% of the time) or increment it under the lock
+// Exclusive locks take the lock exclusively for reads too
+template <typename Lock>
+void read_or_inc(Lock &s, std::int64_t &val, int read_pct, int tid) {
+  // Each thread gets its own generator (seeded by thread for repeatable runs)
+  std::minstd_rand rng(tid + 1);
+  for (int i = 0; i < kIncrements; i++) {
+    if (static_cast<int>(rng() % 100) < read_pct) {
+      if constexpr (has_shared<Lock>::value) {
+        s.lock_shared();
+        benchmark::DoNotOptimize(val);
+        s.unlock_shared();
+      } else {
+        s.lock();
+        benchmark::DoNotOptimize(val);
+        s.unlock();
+      }
+    } else {
+      s.lock();
+      val++;
+      s.unlock();
+    }
+  }
+}
+
+// Increment val without a lock (lock-free baseline)
+inline void inc(std::atomic<std::int64_t> &val) {
+  for (int i = 0; i < kIncrements; i++) val++;
+}
+
+// Pin the calling thread to a single CPU
+inline void pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Measure pause and check for WAITPKG before anything is timed
+// Otherwise the first timed backoff (or deadline) pays for the couple of
+// milliseconds of calibration while every other thread waits on it
+inline void calibrate_pause_before_timing() {
+  spinlocks::pause_calibration();
+  spinlocks::waitpkg_supported();
+}
+
+// Pool of pinned threads that live for the whole benchmark
+// Workers wait at a start barrier, so they all hit the lock at the same
+// instant, and only the time between release and the last worker finishing
+// is measured (no thread creation or teardown)
+// Given a PerfTotals, each worker opens its counters once, enables them
+// before the start barrier, and adds them in after the done barrier, so
+// counter setup stays out of the measured time (counts include the time
+// spent at the barriers)
+class WorkerPool {
+ private:
+  std::vector<std::thread> workers;
+
+  // Work for the current round (takes the worker's index)
+  std::function<void(int)> task;
+
+  // Bumped to release the workers for a new round
+  std::atomic<std::uint64_t> generation{0};
+
+  // Workers waiting at the barrier, and workers done with this round
+  std::atomic<int> ready{0};
+  std::atomic<int> done{0};
+
+  // Tells the workers to exit
+  std::atomic<bool> stop{false};
+
+  // CPUs to pin workers to (worker i goes to cpus[i % cpus.size()])
+  std::vector<int> cpus;
+
+  // Where workers add their hardware counters (nullptr to not count)
+  PerfTotals *perf;
+
+  void worker(int tid) {
+    pin_to_cpu(cpus[tid % cpus.size()]);
+    std::unique_ptr<PerfCounters> counters;
+    if (perf != nullptr) counters = std::make_unique<PerfCounters>();
+
+    std::uint64_t seen = 0;
+    while (1) {
+      // Wait at the barrier for the next round
+      if (counters) counters->start();
+      ready.fetch_add(1);
+      while (generation.load(std::memory_order_acquire) == seen)
+        std::this_thread::yield();
+      seen++;
+      if (stop.load()) return;
+
+      task(tid);
+      done.fetch_add(1, std::memory_order_release);
+      if (counters) counters->stop(*perf);
+    }
+  }
+
+ public:
+  // Pin workers round-robin over cpus (defaults to every CPU in order)
+  explicit WorkerPool(int num_threads, std::vector<int> cpus = {},
+                      PerfTotals *perf = nullptr)
+      : cpus(std::move(cpus)), perf(perf) {
+    calibrate_pause_before_timing();
+    if (this->cpus.empty()) {
+      for (auto i = 0u; i < std::thread::hardware_concurrency(); i++)
+        this->cpus.push_back(i);
+    }
+
+    workers.reserve(num_threads);
+    for (int i = 0; i < num_threads; i++)
+      workers.emplace_back([this, i] { worker(i); });
+  }
+
+  ~WorkerPool() {
+    stop.store(true);
+    generation.fetch_add(1, std::memory_order_release);
+    for (auto &w : workers) w.join();
+  }
+
+  int size() const { return static_cast<int>(workers.size()); }
+
+  // Run fn on every worker and return the elapsed time in seconds
+  double run(std::function<void(int)> fn) {
+    // Wait for every worker to reach the barrier
+    while (ready.load() != size()) std::this_thread::yield();
+    ready.store(0);
+    done.store(0);
+    task = std::move(fn);
+
+    // Release the workers and wait for them to finish
+    auto start = std::chrono::steady_clock::now();
+    generation.fetch_add(1, std::memory_order_release);
+    while (done.load(std::memory_order_acquire) != size())
+      std::this_thread::yield();
+    auto end = std::chrono::steady_clock::now();
+
+    // Wait for every worker to add its counters (and get back to the
+    // barrier) before anyone reads them
+    while (ready.load() != size()) std::this_thread::yield();
+
+    return std::chrono::duration<double>(end - start).count();
+  }
+};
+
+// Locks built on Spinlock have a contention profile (stats())
+template <typename Lock, typename = void>
+struct has_stats : std::false_type {};
+template <typename Lock>
+struct has_stats<Lock, std::void_t<decltype(std::declval<Lock &>().stats())>>
+    : std::true_type {};
+
+// Report a lock's contention profile as user counters
+// Only filled in when built with -DSPINLOCKS_STATS
+template <typename Lock>
+void report_stats(benchmark::State &s, const Lock &sl) {
+#ifdef SPINLOCKS_STATS
+  if constexpr (has_stats<Lock>::value) {
+    auto stats = sl.stats();
+    double n = std::max<double>(stats.acquisitions, 1);
+    s.counters["failed_per_acquire"] = stats.failed_attempts / n;
+    s.counters["pause_iters_per_acquire"] = stats.pause_iters / n;
+    s.counters["hold_cycles"] = stats.hold_cycles / n;
+    s.counters["wait_p50_cycles"] = stats.wait_cycles.percentile(50);
+    s.counters["wait_p99_cycles"] = stats.wait_cycles.percentile(99);
+    s.counters["wait_max_cycles"] = stats.wait_cycles.max();
+  }
+#else
+  (void)s;
+  (void)sl;
+#endif
+}
+
+// Report the hardware counters (those we could open) per acquisition
+// (every thread does kIncrements)
+// Also reports instructions per cycle when we have both
+inline void report_perf_counters(benchmark::State &s, const PerfTotals &perf) {
+  double acquires = static_cast<double>(s.range(0) * kIncrements);
+  for (int i = 0; i < kNumPerfEvents; i++) {
+    if (!perf.has(i)) continue;
+    s.counters[std::string(perf_events()[i].name) + "_per_acquire"] =
+        benchmark::Counter(perf.count(i) / acquires,
+                           benchmark::Counter::kAvgIterations);
+  }
+  if (perf.has(0) && perf.has(1) && perf.count(0) != 0)
+    s.counters["ipc"] = static_cast<double>(perf.count(1)) / perf.count(0);
+}
+
+// Launch num_threads threads running fn each timing iteration
+// Hardware counters are opened once on this thread and inherited by every
+// thread it launches (so they also count launching and joining)
+template <typename F>
+void run_threads(benchmark::State &s, F fn) {
+  // Sweep over a range of threads
+  auto num_threads = s.range(0);
+
+  // Allocate a vector of threads
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  calibrate_pause_before_timing();
+
+  PerfTotals perf;
+  std::unique_ptr<PerfCounters> counters;
+  if (perf_counters_enabled()) {
+    counters = std::make_unique<PerfCounters>(true);
+    counters->start();
+  }
+
+  // Timing loop
+  for (auto _ : s) {
+    for (auto i = 0u; i < num_threads; i++) threads.emplace_back(fn, i);
+    // Join threads
+    for (auto &thread : threads) thread.join();
+    threads.clear();
+  }
+
+  if (counters) counters->stop(perf);
+  report_perf_counters(s, perf);
+}
+
+// Report the cost of each acquisition (every thread does kIncrements)
+inline void report_time_per_acquire(benchmark::State &s) {
+  s.counters["time_per_acquire"] = benchmark::Counter(
+      s.range(0) * kIncrements,
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+}
+
+// Run fn on a persistent pool of pinned threads each timing iteration
+// Only the time spent in fn is reported (use with pool_sweep)
+template <typename F>
+void run_pool(benchmark::State &s, F fn, std::vector<int> cpus = {}) {
+  // Sweep over a range of threads
+  auto num_threads = s.range(0);
+  PerfTotals perf;
+  WorkerPool pool(num_threads, std::move(cpus),
+                  perf_counters_enabled() ? &perf : nullptr);
+
+  // Timing loop
+  for (auto _ : s) s.SetIterationTime(pool.run(fn));
+
+  report_time_per_acquire(s);
+  report_perf_counters(s, perf);
+}
+
+// Every thread increments a shared value under the lock
+template <typename Lock>
+void lock_benchmark(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Lock sl;
+  run_threads(s, [&](int) { inc(sl, val); });
+  report_stats(s, sl);
+}
+
+// Same as lock_benchmark, but on a persistent pool of pinned threads
+template <typename Lock>
+void pooled_lock_benchmark(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Lock sl;
+  run_pool(s, [&](int) { inc(sl, val); });
+  report_stats(s, sl);
+}
+
+// Same as pooled_lock_benchmark, but workers are pinned by topology (use
+// with placement_sweep)
+// Skipped when this machine can't do the placement with that many threads
+template <typename Lock>
+void placed_lock_benchmark(benchmark::State &s) {
+  auto placement = static_cast<Placement>(s.range(1));
+  s.SetLabel(placement_name(placement));
+  auto cpus = placement_cpus(placement);
+  if (static_cast<std::int64_t>(cpus.size()) < s.range(0)) {
+    s.SkipWithError("not enough CPUs for this placement");
+    return;
+  }
+
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Lock sl;
+  run_pool(s, [&](int) { inc(sl, val); }, std::move(cpus));
+  report_stats(s, sl);
+}
+
+// Same as pooled_lock_benchmark, but records the wait for every acquisition
+// and who got the lock (use with pool_sweep)
+// Reports:
+//  1.) Wait percentiles in cycles (p50, p99, p99.9, and max)
+//  2.) Jain's fairness index, and the smallest and largest share of
+//      acquisitions one thread got while every thread was competing
+//  3.) The longest run of back-to-back acquisitions by one thread
+template <typename Lock>
+void latency_benchmark(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  auto num_threads = static_cast<int>(s.range(0));
+  std::vector<ThreadLatency> latency(num_threads);
+  FairnessTracker fairness(num_threads);
+
+  Lock sl;
+  WorkerPool pool(num_threads);
+  auto fn = [&](int tid) {
+    timed_inc(sl, val, latency[tid], fairness, tid);
+  };
+
+  // Timing loop
+  for (auto _ : s) {
+    fairness.start_round();
+    s.SetIterationTime(pool.run(fn));
+  }
+  report_time_per_acquire(s);
+
+  // Merge every thread's waits
+  spinlocks::Histogram wait_cycles;
+  for (auto &l : latency) wait_cycles.merge(l.wait_cycles);
+  s.counters["p50_cycles"] = wait_cycles.percentile(50);
+  s.counters["p99_cycles"] = wait_cycles.percentile(99);
+  s.counters["p999_cycles"] = wait_cycles.percentile(99.9);
+  s.counters["max_cycles"] = wait_cycles.max();
+
+  s.counters["jain_fairness"] = fairness.jain_index();
+  s.counters["min_share"] = fairness.min_share();
+  s.counters["max_share"] = fairness.max_share();
+  s.counters["longest_run"] = fairness.longest_run();
+}
+
+// Every thread runs a Workload on the lock (use with workload_sweep)
+// Arguments are threads, cs_work, cs_lines, think_work, and burst
+template <typename Lock>
+void workload_benchmark(benchmark::State &s) {
+  Workload w;
+  w.cs_work = static_cast<int>(s.range(1));
+  w.cs_lines = std::clamp(static_cast<int>(s.range(2)), 0, kMaxLines);
+  w.think_work = static_cast<int>(s.range(3));
+  w.burst = std::max(static_cast<int>(s.range(4)), 1);
+
+  // Data we will write
+  SharedLines data;
+
+  Lock sl;
+  run_pool(s, [&](int) { run_workload(sl, data, w); });
+}
+
+// Every thread reads or increments a shared value (use with rw_sweep)
+template <typename Lock>
+void rw_benchmark(benchmark::State &s) {
+  // Value we will read or increment
+  std::int64_t val = 0;
+
+  // Percentage of operations that are reads
+  int read_pct = static_cast<int>(s.range(1));
+
+  Lock sl;
+  run_pool(s, [&](int tid) { read_or_inc(sl, val, read_pct, tid); });
+}
+
+// Every thread increments a shared atomic value
+inline void atomic_benchmark(benchmark::State &s) {
+  // Value we will increment
+  std::atomic<std::int64_t> val{0};
+
+  run_threads(s, [&](int) { inc(val); });
+}
+
+// Same as atomic_benchmark, but on a persistent pool of pinned threads
+inline void pooled_atomic_benchmark(benchmark::State &s) {
+  // Value we will increment
+  std::atomic<std::int64_t> val{0};
+
+  run_pool(s, [&](int) { inc(val); });
+}
+
+// Thread sweep used by every benchmark
+inline void thread_sweep(benchmark::internal::Benchmark *b) {
+  b->RangeMultiplier(2)
+      ->Range(1, std::thread::hardware_concurrency())
+      ->UseRealTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+// Thread sweep for the worker pool (time comes from the pool, not the loop)
+inline void pool_sweep(benchmark::internal::Benchmark *b) {
+  b->RangeMultiplier(2)
+      ->Range(1, std::thread::hardware_concurrency())
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+// Thread sweep crossed with every placement (for placed_lock_benchmark)
+// Starts at 2 threads (one thread is placed the same everywhere)
+inline void placement_sweep(benchmark::internal::Benchmark *b) {
+  auto max_threads = std::max(2u, std::thread::hardware_concurrency());
+  b->ArgsProduct({benchmark::CreateRange(2, max_threads, 2),
+                  {static_cast<int>(Placement::kSmtPair),
+                   static_cast<int>(Placement::kSameLlc),
+                   static_cast<int>(Placement::kCrossLlc),
+                   static_cast<int>(Placement::kCrossSocket)}})
+      ->ArgNames({"threads", "placement"})
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+// Thread sweep past the number of cores (up to 4 threads per core)
+inline void oversubscribed_sweep(benchmark::internal::Benchmark *b) {
+  b->RangeMultiplier(2)
+      ->Range(1, 4 * std::thread::hardware_concurrency())
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+// Thread sweep crossed with a few contention profiles (for
+// workload_benchmark). Each profile is {cs_work, cs_lines, think_work, burst}
+inline void workload_sweep(benchmark::internal::Benchmark *b) {
+  const std::vector<std::vector<std::int64_t>> profiles = {
+      // Short critical section, steady arrivals
+      {50, 1, 500, 1},
+      // Longer critical section writing several lines
+      {500, 4, 500, 1},
+      // Same load as the first, but arriving in bursts
+      {50, 1, 500, 16},
+      // Many lines written, mostly thinking
+      {100, 16, 5000, 1},
+  };
+  for (auto threads : benchmark::CreateRange(
+           1, std::thread::hardware_concurrency(), 2))
+    for (auto &p : profiles) b->Args({threads, p[0], p[1], p[2], p[3]});
+  b->ArgNames({"threads", "cs_work", "cs_lines", "think_work", "burst"})
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+// Thread sweep crossed with the percentage of reads (for rw_benchmark)
+inline void rw_sweep(benchmark::internal::Benchmark *b) {
+  b->ArgsProduct({benchmark::CreateRange(
+                      1, std::thread::hardware_concurrency(), 2),
+                  {50, 90, 99, 100}})
+      ->ArgNames({"threads", "read_pct"})
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+}  // namespace bench
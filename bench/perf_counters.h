@@ -0,0 +1,207 @@
+// This header contains the hardware performance counters for the benchmark
+// harness (perf_event_open)
+// Each worker thread counts its own cycles, instructions, cache misses, and
+// loads that hit a line modified in another core's cache (HITM, the
+// cache-to-cache transfers a bouncing lock causes), and the harness adds
+// them up across threads
+// Counting is off unless BENCH_PERF_COUNTERS is set in the environment
+// (e.g., BENCH_PERF_COUNTERS=1 ./naive), so default runs aren't perturbed
+// Only user space is counted (that's all perf_event_paranoid=2 allows)
+// Counters that can't be opened (no PMU in a VM, perf_event_paranoid=3,
+// seccomp in a container) are left out, and the benchmarks just report time
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <cpuid.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace bench {
+
+// An event we count
+struct PerfEvent {
+  // Name of the benchmark counter
+  const char *name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+// Config for a cache event (which cache, which operation, hit or miss)
+constexpr std::uint64_t cache_event(std::uint64_t cache, std::uint64_t op,
+                                    std::uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+// Is this an Intel CPU? (CPUID leaf 0 vendor string)
+inline bool intel_cpu() {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return false;
+  char vendor[12];
+  std::memcpy(vendor, &ebx, 4);
+  std::memcpy(vendor + 4, &edx, 4);
+  std::memcpy(vendor + 8, &ecx, 4);
+  return std::memcmp(vendor, "GenuineIntel", 12) == 0;
+}
+
+// Loads that hit a line modified in another core's cache
+// There's no generic HITM event. On Intel cores (Nehalem through Golden
+// Cove) it's event 0xd2, umask 0x04 (MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM,
+// called XSNP_FWD on newer cores). Other CPUs don't count it
+constexpr std::uint64_t kIntelHitm = 0x04d2;
+
+constexpr int kNumPerfEvents = 5;
+
+// Everything we try to count
+inline const std::array<PerfEvent, kNumPerfEvents> &perf_events() {
+  static const std::array<PerfEvent, kNumPerfEvents> events = {{
+      {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"l1d_misses", PERF_TYPE_HW_CACHE,
+       cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                   PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"llc_misses", PERF_TYPE_HW_CACHE,
+       cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                   PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      // PERF_TYPE_MAX means we don't have the event
+      {"hitm", intel_cpu() ? PERF_TYPE_RAW : PERF_TYPE_MAX, kIntelHitm},
+  }};
+  return events;
+}
+
+// Did we ask for counters? (BENCH_PERF_COUNTERS set, and not "0")
+inline bool perf_counters_enabled() {
+  static const bool enabled = [] {
+    const char *env = std::getenv("BENCH_PERF_COUNTERS");
+    return env != nullptr && *env != '\0' && std::strcmp(env, "0") != 0;
+  }();
+  return enabled;
+}
+
+// Value of kernel.perf_event_paranoid (-1 if we can't read it)
+inline int perf_event_paranoid() {
+  std::ifstream f("/proc/sys/kernel/perf_event_paranoid");
+  int level = -1;
+  f >> level;
+  return level;
+}
+
+// Counts added up across every thread
+class PerfTotals {
+ private:
+  std::array<std::atomic<std::uint64_t>, kNumPerfEvents> counts{};
+  // Bit i is set once some thread counted event i
+  std::atomic<std::uint32_t> counted{0};
+
+ public:
+  void add(int event, std::uint64_t count) {
+    counts[event].fetch_add(count, std::memory_order_relaxed);
+    counted.fetch_or(1u << event, std::memory_order_relaxed);
+  }
+
+  bool has(int event) const {
+    return counted.load(std::memory_order_relaxed) & (1u << event);
+  }
+  std::uint64_t count(int event) const {
+    return counts[event].load(std::memory_order_relaxed);
+  }
+};
+
+// The calling thread's counters
+// Every event is opened on its own (not as a group), so one event the CPU
+// doesn't have doesn't cost us the others
+// With inherit, threads the calling thread creates afterwards are counted
+// too (their counts are added in when they exit)
+class PerfCounters {
+ private:
+  std::array<int, kNumPerfEvents> fds;
+
+  // Count event for the calling thread, on any CPU (disabled until start())
+  static int open(const PerfEvent &event, bool inherit) {
+    if (event.type == PERF_TYPE_MAX) return -1;
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = inherit;
+    // So we can scale the count if the event was multiplexed
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  // Say (once) why there are no counters
+  static void warn_unavailable(int err) {
+    static std::atomic<bool> warned{false};
+    if (warned.exchange(true)) return;
+    std::fprintf(stderr,
+                 "bench: hardware counters unavailable (%s, "
+                 "perf_event_paranoid=%d), reporting time only\n",
+                 std::strerror(err), perf_event_paranoid());
+  }
+
+ public:
+  explicit PerfCounters(bool inherit = false) {
+    bool any = false;
+    int err = ENOENT;
+    for (int i = 0; i < kNumPerfEvents; i++) {
+      fds[i] = open(perf_events()[i], inherit);
+      if (fds[i] >= 0)
+        any = true;
+      else if (perf_events()[i].type != PERF_TYPE_MAX)
+        err = errno;
+    }
+    if (!any) warn_unavailable(err);
+  }
+
+  ~PerfCounters() {
+    for (auto fd : fds)
+      if (fd >= 0) close(fd);
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // Start counting from zero
+  void start() {
+    for (auto fd : fds) {
+      if (fd < 0) continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  // Stop counting and add the counts to totals
+  void stop(PerfTotals &totals) {
+    for (int i = 0; i < kNumPerfEvents; i++) {
+      if (fds[i] < 0) continue;
+      ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+      // Count, time enabled, and time actually counting
+      std::uint64_t v[3];
+      if (read(fds[i], v, sizeof(v)) != sizeof(v) || v[2] == 0) continue;
+      // Scale up if we only had the counter for part of the time
+      if (v[2] < v[1])
+        v[0] = static_cast<std::uint64_t>(static_cast<double>(v[0]) * v[1] /
+                                          v[2]);
+      totals.add(i, v[0]);
+    }
+  }
+};
+
+}  // namespace bench
@@ -0,0 +1,190 @@
+// This header contains the CPU topology used to place worker threads
+// Topology comes from /sys/devices/system/cpu (SMT siblings, last level
+// cache, and package of every CPU)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/spinlocks/numa.h"
+
+namespace bench {
+
+// Where a CPU is
+// Cores and last level caches are named by their first CPU
+struct CpuInfo {
+  int cpu;
+  int core;
+  int llc;
+  int package;
+  // Which hardware thread of its core this CPU is (0 for the first)
+  int smt_index;
+};
+
+// Read the topology of one CPU
+// Anything the kernel doesn't report makes the CPU its own core and cache,
+// on package 0
+inline CpuInfo read_cpu_info(int cpu) {
+  std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+  CpuInfo info{cpu, cpu, cpu, 0, 0};
+
+  auto siblings = spinlocks::parse_cpu_list(
+      spinlocks::read_sysfs(dir + "/topology/thread_siblings_list"));
+  if (!siblings.empty()) {
+    info.core = siblings.front();
+    info.smt_index = static_cast<int>(
+        std::find(siblings.begin(), siblings.end(), cpu) - siblings.begin());
+  }
+
+  auto package =
+      spinlocks::read_sysfs(dir + "/topology/physical_package_id");
+  if (!package.empty()) info.package = std::max(std::stoi(package), 0);
+
+  // The last level cache is the highest level cache index
+  int llc_level = 0;
+  for (int index = 0;; index++) {
+    auto cache = dir + "/cache/index" + std::to_string(index);
+    auto level = spinlocks::read_sysfs(cache + "/level");
+    if (level.empty()) break;
+    auto shared = spinlocks::parse_cpu_list(
+        spinlocks::read_sysfs(cache + "/shared_cpu_list"));
+    if (std::stoi(level) >= llc_level && !shared.empty()) {
+      llc_level = std::stoi(level);
+      info.llc = shared.front();
+    }
+  }
+  return info;
+}
+
+// Topology of every online CPU (read once)
+inline const std::vector<CpuInfo> &cpu_topology() {
+  static const std::vector<CpuInfo> cpus = [] {
+    std::vector<CpuInfo> cpus;
+    auto online = spinlocks::parse_cpu_list(
+        spinlocks::read_sysfs("/sys/devices/system/cpu/online"));
+    if (online.empty()) {
+      for (auto i = 0u; i < std::thread::hardware_concurrency(); i++)
+        online.push_back(i);
+    }
+    for (auto cpu : online) cpus.push_back(read_cpu_info(cpu));
+    return cpus;
+  }();
+  return cpus;
+}
+
+// Topology of one CPU (nullptr if it isn't online)
+inline const CpuInfo *find_cpu(int cpu) {
+  for (auto &info : cpu_topology())
+    if (info.cpu == cpu) return &info;
+  return nullptr;
+}
+
+// Where workers go
+enum class Placement {
+  // Fill both hardware threads of a core before moving to the next core
+  kSmtPair,
+  // One last level cache (one thread per core first)
+  kSameLlc,
+  // Round-robin across last level caches
+  kCrossLlc,
+  // Round-robin across packages (sockets)
+  kCrossSocket,
+};
+
+inline const char *placement_name(Placement p) {
+  switch (p) {
+    case Placement::kSmtPair:
+      return "smt_pair";
+    case Placement::kSameLlc:
+      return "same_llc";
+    case Placement::kCrossLlc:
+      return "cross_llc";
+    case Placement::kCrossSocket:
+      return "cross_socket";
+  }
+  return "unknown";
+}
+
+// Group CPUs by key (groups in order of their first CPU)
+// Within a group, the first hardware thread of every core comes first, so
+// threads only share a core once every core has one
+template <typename Key>
+std::vector<std::vector<int>> group_cpus(Key key) {
+  auto cpus = cpu_topology();
+  std::stable_sort(cpus.begin(), cpus.end(),
+                   [](const CpuInfo &a, const CpuInfo &b) {
+                     return a.smt_index < b.smt_index;
+                   });
+  std::map<int, std::vector<int>> groups;
+  for (auto &info : cpus) groups[key(info)].push_back(info.cpu);
+
+  std::vector<std::vector<int>> result;
+  for (auto &group : groups) result.push_back(std::move(group.second));
+  return result;
+}
+
+// Take one CPU from each group in turn
+inline std::vector<int> interleave(
+    const std::vector<std::vector<int>> &groups) {
+  std::vector<int> cpus;
+  for (std::size_t i = 0;; i++) {
+    bool added = false;
+    for (auto &group : groups) {
+      if (i < group.size()) {
+        cpus.push_back(group[i]);
+        added = true;
+      }
+    }
+    if (!added) return cpus;
+  }
+}
+
+// CPUs to pin workers to for a placement (worker i goes to cpus[i])
+// Empty if this machine can't do the placement (e.g., no SMT, one socket)
+inline std::vector<int> placement_cpus(Placement p) {
+  switch (p) {
+    case Placement::kSmtPair: {
+      std::vector<int> cpus;
+      bool smt = false;
+      for (auto &core : group_cpus([](const CpuInfo &c) { return c.core; })) {
+        smt |= core.size() > 1;
+        cpus.insert(cpus.end(), core.begin(), core.end());
+      }
+      return smt ? cpus : std::vector<int>{};
+    }
+    case Placement::kSameLlc: {
+      // The biggest last level cache
+      auto llcs = group_cpus([](const CpuInfo &c) { return c.llc; });
+      return *std::max_element(
+          llcs.begin(), llcs.end(),
+          [](auto &a, auto &b) { return a.size() < b.size(); });
+    }
+    case Placement::kCrossLlc: {
+      auto llcs = group_cpus([](const CpuInfo &c) { return c.llc; });
+      return llcs.size() > 1 ? interleave(llcs) : std::vector<int>{};
+    }
+    case Placement::kCrossSocket: {
+      auto packages = group_cpus([](const CpuInfo &c) { return c.package; });
+      return packages.size() > 1 ? interleave(packages) : std::vector<int>{};
+    }
+  }
+  return {};
+}
+
+// How close two CPUs are ("smt", "llc", "package", or "remote")
+inline const char *cpu_distance(int a, int b) {
+  auto *x = find_cpu(a);
+  auto *y = find_cpu(b);
+  if (x == nullptr || y == nullptr) return "unknown";
+  if (x->core == y->core) return "smt";
+  if (x->llc == y->llc) return "llc";
+  if (x->package == y->package) return "package";
+  return "remote";
+}
+
+}  // namespace bench
@@ -0,0 +1,54 @@
+// This program benchmarks CLH queue locks in C++
+// Optimizations:
+//  1.) Ticket-style fairness (FIFO queue)
+//  2.) Each waiter spins on its predecessor's node
+//  3.) Nodes are recycled (one atomic exchange per acquire)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/clh_lock.h"
+
+// Queue lock
+// Each thread brings its own handle
+using Spinlock = spinlocks::CLHLock;
+
+// Increment val once each time the lock is acquired
+void inc(Spinlock &s, Spinlock::Handle &h, std::int64_t &val) {
+  for (int i = 0; i < bench::kIncrements; i++) {
+    Spinlock::Guard g(s, h);
+    val++;
+  }
+}
+
+// Small Benchmark
+static void clh_lock(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Spinlock sl;
+  bench::run_threads(s, [&](int) {
+    Spinlock::Handle h;
+    inc(sl, h, val);
+  });
+}
+BENCHMARK(clh_lock)->Apply(bench::thread_sweep);
+
+// Small Benchmark
+// Nodes come from a thread-local pool (plain lock()/unlock())
+static void anonymous_clh_lock(benchmark::State &s) {
+  bench::lock_benchmark<spinlocks::AnonymousCLHLock>(s);
+}
+BENCHMARK(anonymous_clh_lock)->Apply(bench::thread_sweep);
+
+// Workload Benchmark
+// The workload takes the lock with plain lock()/unlock(), so this uses
+// the anonymous CLH lock
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::AnonymousCLHLock)
+    ->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+// This program benchmarks a NUMA-aware cohort lock in C++
+// Optimizations:
+//  1.) Hierarchical (one local lock per NUMA node, and one global lock)
+//  2.) Hand off to waiters on the same node (the global lock stays put)
+// Threads are pinned round-robin across NUMA nodes, and we count how often
+// the lock moves to a different node
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/cohort_lock.h"
+#include "../include/spinlocks/numa.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Interleave the CPUs of every NUMA node (node 0, node 1, node 0, ...)
+// So thread i ends up on node i % num_numa_nodes()
+std::vector<int> interleaved_cpus() {
+  std::vector<std::vector<int>> node_cpus;
+  for (int node = 0; node < spinlocks::num_numa_nodes(); node++)
+    node_cpus.push_back(spinlocks::numa_node_cpus(node));
+
+  std::vector<int> cpus;
+  for (std::size_t i = 0; cpus.size() < std::thread::hardware_concurrency();
+       i++) {
+    bool added = false;
+    for (auto &node : node_cpus) {
+      if (i < node.size()) {
+        cpus.push_back(node[i]);
+        added = true;
+      }
+    }
+    if (!added) break;
+  }
+  return cpus;
+}
+
+// Increment val once each time the lock is acquired
+// Also count handoffs where the lock moved to a different node
+template <typename Lock>
+void inc(Lock &s, std::int64_t &val, int &last_node,
+         std::int64_t &cross_node) {
+  // We are pinned, so our node does not change
+  int node = spinlocks::current_numa_node();
+  for (int i = 0; i < bench::kIncrements; i++) {
+    s.lock();
+    val++;
+    if (node != last_node) {
+      cross_node++;
+      last_node = node;
+    }
+    s.unlock();
+  }
+}
+
+// Small Benchmark
+template <typename Lock>
+static void cross_node(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  // Last node to hold the lock, and how many times that changed
+  int last_node = -1;
+  std::int64_t cross_node = 0;
+
+  Lock sl;
+  bench::run_pool(
+      s, [&](int) { inc(sl, val, last_node, cross_node); },
+      interleaved_cpus());
+
+  // Fraction of acquisitions where the lock came from another node
+  s.counters["cross_node_handoffs"] =
+      static_cast<double>(cross_node) / static_cast<double>(val);
+}
+BENCHMARK_TEMPLATE(cross_node, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(cross_node, spinlocks::TicketLock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(cross_node, spinlocks::CohortLock<>)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(cross_node,
+                   spinlocks::CohortLock<spinlocks::TicketLock>)
+    ->Apply(bench::pool_sweep);
+
+// Workload Benchmark
+// Workers are pinned in CPU order here (not interleaved across nodes)
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::CohortLock<>)
+    ->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
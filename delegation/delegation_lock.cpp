@@ -0,0 +1,85 @@
+// This program benchmarks a delegation lock (remote core locking) in C++
+// Optimizations:
+//  1.) A pinned server thread runs every increment (the value stays in its
+//      cache)
+//  2.) Clients send closures through their own padded mailbox
+// We sweep clients past the number of cores, where pthread_spinlock_t falls
+// over, and compare against it and the ticket lock (up to the number of
+// cores)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/delegation_lock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Server goes on the last CPU, and clients on the rest
+// With one CPU the server isn't pinned (clients never get pinned to the
+// server's CPU)
+int server_cpu() {
+  auto cpus = static_cast<int>(std::thread::hardware_concurrency());
+  return cpus < 2 ? -1 : cpus - 1;
+}
+// Empty means every CPU (what run_pool does by default)
+std::vector<int> client_cpus() {
+  std::vector<int> cpus;
+  for (int i = 0; i < server_cpu(); i++) cpus.push_back(i);
+  return cpus;
+}
+
+// Increment val on the server, waiting for each one
+void sync_inc(spinlocks::DelegationLock &dl, std::int64_t &val) {
+  auto client = dl.connect();
+  for (int i = 0; i < bench::kIncrements; i++)
+    client.execute([&] { val++; });
+}
+
+// Increment val on the server without waiting (until the end)
+void async_inc(spinlocks::DelegationLock &dl, std::int64_t &val) {
+  auto client = dl.connect();
+  for (int i = 0; i < bench::kIncrements; i++) client.post([&] { val++; });
+  client.flush();
+}
+
+// Small Benchmark
+static void delegation_sync(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  spinlocks::DelegationLock dl(server_cpu());
+  bench::run_pool(s, [&](int) { sync_inc(dl, val); }, client_cpus());
+}
+BENCHMARK(delegation_sync)->Apply(bench::oversubscribed_sweep);
+
+// Small Benchmark
+static void delegation_async(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  spinlocks::DelegationLock dl(server_cpu());
+  bench::run_pool(s, [&](int) { async_inc(dl, val); }, client_cpus());
+}
+BENCHMARK(delegation_async)->Apply(bench::oversubscribed_sweep);
+
+// Same increments with the locks taken by every thread
+template <typename Lock>
+static void locked(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Lock sl;
+  bench::run_pool(s, [&](int) { bench::inc(sl, val); }, client_cpus());
+}
+BENCHMARK_TEMPLATE(locked, bench::PthreadSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+// The ticket lock only goes up to one thread per core. Past that it hits a
+// preemption convoy (every handoff waits for the next ticket holder to be
+// scheduled again), and a single run takes orders of magnitude longer
+BENCHMARK_TEMPLATE(locked, spinlocks::TicketLock)->Apply(bench::pool_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+// This program benchmarks hardware lock elision (TSX/RTM) in C++
+// Optimizations:
+//  1.) Critical sections run as hardware transactions (the lock is only
+//      read, never written)
+//  2.) Falls back to the spinlock after repeated aborts
+// Without RTM every acquisition falls back to the spinlock
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/cache_line.h"
+#include "../include/spinlocks/elided_lock.h"
+#include "../include/spinlocks/spinlock.h"
+
+// A counter for each thread (on its own cache line)
+struct alignas(spinlocks::kCacheLineSize) Counter {
+  std::int64_t value = 0;
+};
+
+// Add up every worker's elision counts
+class ElisionTotals {
+ private:
+  std::mutex m;
+  spinlocks::ElisionStats total;
+
+ public:
+  // Called by each worker with its counts from before and after a round
+  void add(const spinlocks::ElisionStats &before,
+           const spinlocks::ElisionStats &after) {
+    std::lock_guard<std::mutex> g(m);
+    total.attempts += after.attempts - before.attempts;
+    total.commits += after.commits - before.commits;
+    total.lock_busy += after.lock_busy - before.lock_busy;
+    total.conflict += after.conflict - before.conflict;
+    total.capacity += after.capacity - before.capacity;
+    total.other += after.other - before.other;
+    total.fallbacks += after.fallbacks - before.fallbacks;
+  }
+
+  // Report rates as a fraction of acquisitions (aborts as a fraction of
+  // transactions started)
+  void report(benchmark::State &s) {
+    double acquisitions = total.commits + total.fallbacks;
+    double attempts = total.attempts;
+    auto rate = [](double n, double d) { return d == 0 ? 0 : n / d; };
+    s.counters["rtm"] = spinlocks::rtm_supported();
+    s.counters["elided"] = rate(total.commits, acquisitions);
+    s.counters["fallback"] = rate(total.fallbacks, acquisitions);
+    s.counters["abort_lock_busy"] = rate(total.lock_busy, attempts);
+    s.counters["abort_conflict"] = rate(total.conflict, attempts);
+    s.counters["abort_capacity"] = rate(total.capacity, attempts);
+    s.counters["abort_other"] = rate(total.other, attempts);
+  }
+};
+
+// Every thread increments its own counter under the same lock
+// The critical sections never touch the same data (elision's best case)
+template <typename Lock>
+static void disjoint(benchmark::State &s) {
+  std::vector<Counter> counters(s.range(0));
+  ElisionTotals totals;
+
+  Lock sl;
+  bench::run_pool(s, [&](int tid) {
+    auto before = spinlocks::thread_elision_stats();
+    for (int i = 0; i < bench::kIncrements; i++)
+      bench::locked(sl, [&] { counters[tid].value++; });
+    totals.add(before, spinlocks::thread_elision_stats());
+  });
+  totals.report(s);
+}
+BENCHMARK_TEMPLATE(disjoint, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(disjoint, spinlocks::ElidedLock<>)
+    ->Apply(bench::pool_sweep);
+
+// Every thread increments the same value (every transaction conflicts)
+template <typename Lock>
+static void shared(benchmark::State &s) {
+  std::int64_t val = 0;
+  ElisionTotals totals;
+
+  Lock sl;
+  bench::run_pool(s, [&](int) {
+    auto before = spinlocks::thread_elision_stats();
+    bench::inc(sl, val);
+    totals.add(before, spinlocks::thread_elision_stats());
+  });
+  totals.report(s);
+}
+BENCHMARK_TEMPLATE(shared, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(shared, spinlocks::ElidedLock<>)->Apply(bench::pool_sweep);
+
+// Workload Benchmark
+// Every critical section writes the same shared lines, so transactions
+// conflict whenever critical sections overlap
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::ElidedLock<>)
+    ->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,43 @@
+// This program benchmarks flat combining in C++
+// Optimizations:
+//  1.) Threads publish increments instead of grabbing a lock
+//  2.) One thread runs every pending increment while the value stays in its
+//      cache
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/flat_combining.h"
+#include "../include/spinlocks/mcs_lock.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Increment val once for each combined operation
+void inc(spinlocks::FlatCombiner &fc, std::int64_t &val) {
+  for (int i = 0; i < bench::kIncrements; i++) fc.combine([&] { val++; });
+}
+
+// Small Benchmark
+static void flat_combining(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  spinlocks::FlatCombiner fc;
+  bench::run_pool(s, [&](int) { inc(fc, val); });
+}
+BENCHMARK(flat_combining)->Apply(bench::pool_sweep);
+
+// Same increments with our spinlocks (and the lock-free baseline)
+using bench::pooled_lock_benchmark;
+BENCHMARK_TEMPLATE(pooled_lock_benchmark, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(pooled_lock_benchmark, spinlocks::TicketLock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(pooled_lock_benchmark, spinlocks::MCSLock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK(bench::pooled_atomic_benchmark)->Apply(bench::pool_sweep);
+
+BENCHMARK_MAIN();
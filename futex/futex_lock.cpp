@@ -0,0 +1,54 @@
+// This program benchmarks an adaptive spin-then-park lock in C++
+// Optimizations:
+//  1.) Spin with exponential backoff for a bounded budget
+//  2.) Self-tuning spin budget
+//  3.) Sleep in the kernel (futex) once the budget runs out
+// Threads are swept past the number of cores to show oversubscription
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <ctime>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/futex_lock.h"
+#include "../include/spinlocks/spinlock.h"
+
+// CPU time used by every thread in the process so far
+double process_cpu_seconds() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Small Benchmark
+// Also reports how much CPU time each acquisition cost (spinners burn it)
+template <typename Lock>
+static void oversubscribed(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Lock sl;
+  auto cpu_start = process_cpu_seconds();
+  bench::run_pool(s, [&](int) { bench::inc(sl, val); });
+  auto cpu_end = process_cpu_seconds();
+
+  s.counters["cpu_ns_per_acquire"] =
+      (cpu_end - cpu_start) * 1e9 / static_cast<double>(val);
+}
+BENCHMARK_TEMPLATE(oversubscribed, spinlocks::FutexLock<>)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(oversubscribed, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(oversubscribed, bench::PthreadSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(oversubscribed, bench::PthreadMutex)
+    ->Apply(bench::oversubscribed_sweep);
+
+// Workload Benchmark
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::FutexLock<>)
+    ->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
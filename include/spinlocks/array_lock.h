@@ -0,0 +1,84 @@
+// This header contains the array-based queue lock (Anderson's lock)
+// Optimizations:
+//  1.) Ticket-style fairness (FIFO)
+//  2.) Each ticket spins on its own padded slot
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "cache_line.h"
+
+namespace spinlocks {
+
+// Array Lock
+// Same ticket dispatch as the ticket lock (line.fetch_add), but each ticket
+// maps to its own slot in a fixed array. Unlock only writes the next slot,
+// so each handoff only invalidates the next waiter's cache line
+// MaxThreads must be at least the number of threads that can use the lock
+// at once (a power of two, so the slot stays right when the counter wraps)
+// Debug builds (no NDEBUG) assert if two tickets ever need the same slot
+template <std::size_t MaxThreads = 256>
+class ArrayLock {
+  static_assert((MaxThreads & (MaxThreads - 1)) == 0,
+                "MaxThreads must be a power of two");
+
+ private:
+  // Set when the thread with this slot's ticket can take the lock
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<bool> go{false};
+#ifndef NDEBUG
+    // Set from taking a ticket for this slot until we are done with it
+    std::atomic<bool> claimed{false};
+#endif
+  };
+
+  // The latest place taken in line
+  alignas(kCacheLineSize) std::atomic<std::uint32_t> line{0};
+
+  // Only touched by the thread holding the lock
+  alignas(kCacheLineSize) std::uint32_t owner_place = 0;
+
+  // One slot per thread
+  Slot slots[MaxThreads];
+
+ public:
+  // The first ticket can go right away
+  ArrayLock() { slots[0].go.store(true); }
+
+  // Locking mechanism
+  void lock() {
+    // Get the latest place in line (and increment the value)
+    auto place = line.fetch_add(1);
+
+    // Wait until our slot is "called"
+    auto &slot = slots[place % MaxThreads];
+#ifndef NDEBUG
+    // The ticket MaxThreads ahead of us still needs this slot (more than
+    // MaxThreads threads are using the lock)
+    bool slot_in_use = slot.claimed.exchange(true);
+    assert(!slot_in_use && "ArrayLock has more users than MaxThreads");
+    (void)slot_in_use;
+#endif
+    while (!slot.go.load()) _mm_pause();
+
+    // Reset our slot for the next thread that wraps around to it
+    slot.go.store(false);
+#ifndef NDEBUG
+    slot.claimed.store(false);
+#endif
+    owner_place = place;
+  }
+
+  // Unlocking mechanism
+  // Call the next slot in line
+  void unlock() { slots[(owner_place + 1) % MaxThreads].go.store(true); }
+};
+
+}  // namespace spinlocks
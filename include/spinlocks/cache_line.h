@@ -0,0 +1,14 @@
+// This header contains the cache line size used to pad our locks
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <cstddef>
+
+namespace spinlocks {
+
+// Size of a cache line on the machines we care about (x86)
+// Anything threads spin on separately gets its own line
+constexpr std::size_t kCacheLineSize = 64;
+
+}  // namespace spinlocks
@@ -0,0 +1,270 @@
+// This header contains the CLH queue lock
+// Optimizations:
+//  1.) Ticket-style fairness (FIFO queue)
+//  2.) Each waiter spins on its predecessor's node
+//  3.) Nodes are recycled (one atomic exchange per acquire)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <atomic>
+#include <vector>
+
+#include "cache_line.h"
+#include "deadline.h"
+
+namespace spinlocks {
+
+// Queue node used by the CLH locks
+// Padded to a cache line so waiters never share a line
+struct alignas(kCacheLineSize) CLHNode {
+  // Set until the owner of this node releases the lock
+  std::atomic<bool> locked{false};
+};
+
+// CLH Lock
+// Waiters form an implicit queue: each one swaps its node into the tail and
+// spins on the node it got back (its predecessor's)
+// When we release the lock, our node still belongs to our successor, so we
+// take over our predecessor's node instead
+class CLHLock {
+ public:
+  // A thread's place in line
+  // Owns one node at a time, and can be reused across any number of locks
+  class Handle {
+   private:
+    friend class CLHLock;
+    CLHNode *node;
+    CLHNode *pred = nullptr;
+
+   public:
+    Handle() : node(new CLHNode) {}
+    ~Handle() { delete node; }
+    Handle(const Handle &) = delete;
+    Handle &operator=(const Handle &) = delete;
+  };
+
+  // Holds the lock for the current scope
+  class Guard {
+   private:
+    CLHLock &l;
+    Handle &h;
+
+   public:
+    Guard(CLHLock &l, Handle &h) : l(l), h(h) { l.lock(h); }
+    ~Guard() { l.unlock(h); }
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+  };
+
+ private:
+  // Lock is just the last node in line
+  // Starts with a node that is already released (lock is free)
+  alignas(kCacheLineSize) std::atomic<CLHNode *> tail{new CLHNode};
+
+ public:
+  // The node left in the tail belongs to the lock
+  ~CLHLock() { delete tail.load(); }
+
+  // Locking mechanism
+  void lock(Handle &h) {
+    h.node->locked.store(true);
+
+    // Get in line and wait for our predecessor to release the lock
+    h.pred = tail.exchange(h.node);
+    while (h.pred->locked.load()) _mm_pause();
+  }
+
+  // Unlocking mechanism
+  // Release our node to our successor, and recycle our predecessor's node
+  void unlock(Handle &h) {
+    h.node->locked.store(false);
+    h.node = h.pred;
+  }
+};
+
+// CLH Lock with nodes managed internally
+// Nodes come from a thread-local pool, so this satisfies BasicLockable and
+// works with std::lock_guard
+class AnonymousCLHLock {
+ private:
+  // Each thread keeps the nodes it owns so they can be reused
+  struct NodePool {
+    std::vector<CLHNode *> free;
+    ~NodePool() {
+      for (auto node : free) delete node;
+    }
+
+    CLHNode *get() {
+      if (free.empty()) return new CLHNode;
+      auto node = free.back();
+      free.pop_back();
+      return node;
+    }
+    void put(CLHNode *node) { free.push_back(node); }
+  };
+
+  static NodePool &pool() {
+    thread_local NodePool p;
+    return p;
+  }
+
+  // Lock is just the last node in line
+  // Starts with a node that is already released (lock is free)
+  alignas(kCacheLineSize) std::atomic<CLHNode *> tail{new CLHNode};
+
+  // Only touched by the thread holding the lock (kept off the tail's line)
+  alignas(kCacheLineSize) CLHNode *owner_node = nullptr;
+  CLHNode *owner_pred = nullptr;
+
+ public:
+  // The node left in the tail belongs to the lock
+  ~AnonymousCLHLock() { delete tail.load(); }
+
+  // Locking mechanism
+  void lock() {
+    auto node = pool().get();
+    node->locked.store(true);
+
+    // Get in line and wait for our predecessor to release the lock
+    auto pred = tail.exchange(node);
+    while (pred->locked.load()) _mm_pause();
+
+    // Remember our nodes for unlock
+    owner_node = node;
+    owner_pred = pred;
+  }
+
+  // Unlocking mechanism
+  // Release our node to our successor, and recycle our predecessor's node
+  void unlock() {
+    auto node = owner_node;
+    auto pred = owner_pred;
+    node->locked.store(false);
+    pool().put(pred);
+  }
+};
+
+// Abortable CLH Lock (timeout lock)
+// Same queue as the CLH lock, but a waiter that times out can leave the line
+// without blocking the waiters behind it. Each node points at its owner's
+// predecessor instead of holding a flag:
+//  1.) nullptr - The owner is waiting for (or holding) the lock
+//  2.) available() - The owner released the lock
+//  3.) Any other node - The owner gave up, and that node is who they were
+//      waiting on (so their successor waits on it instead)
+// A node belongs to whoever is waiting on it once it stops being nullptr,
+// so nodes are recycled through a thread-local pool by the thread that
+// last looked at them
+class AbortableCLHLock : public TimedLockable<AbortableCLHLock> {
+ private:
+  struct alignas(kCacheLineSize) Node {
+    std::atomic<Node *> pred{nullptr};
+  };
+
+  // Marks a node whose owner released the lock
+  static Node *available() {
+    static Node node;
+    return &node;
+  }
+
+  // Each thread keeps nodes that are free to reuse
+  struct NodePool {
+    std::vector<Node *> free;
+    ~NodePool() {
+      for (auto node : free) delete node;
+    }
+
+    Node *get() {
+      if (free.empty()) return new Node;
+      auto node = free.back();
+      free.pop_back();
+      return node;
+    }
+    void put(Node *node) { free.push_back(node); }
+  };
+
+  static NodePool &pool() {
+    thread_local NodePool p;
+    return p;
+  }
+
+  // Lock is just the last node in line (nullptr when nobody is in line)
+  alignas(kCacheLineSize) std::atomic<Node *> tail{nullptr};
+
+  // Only touched by the thread holding the lock (kept off the tail's line)
+  alignas(kCacheLineSize) Node *owner_node = nullptr;
+
+ public:
+  // A node left in the tail was released, and belongs to the lock
+  ~AbortableCLHLock() { delete tail.load(); }
+
+  // Keep trying until the deadline
+  // If we give up, we leave the line and hand our place to our successor
+  bool try_lock_until(const Deadline &deadline) {
+    auto node = pool().get();
+    node->pred.store(nullptr, std::memory_order_relaxed);
+
+    // Get in line (nobody ahead of us means we have the lock)
+    auto pred = tail.exchange(node);
+    if (pred == nullptr) {
+      owner_node = node;
+      return true;
+    }
+
+    while (1) {
+      auto pred_pred = pred->pred.load(std::memory_order_acquire);
+
+      // Our predecessor released the lock (their node is ours now)
+      if (pred_pred == available()) {
+        pool().put(pred);
+        owner_node = node;
+        return true;
+      }
+
+      // Our predecessor gave up, so wait on who they were waiting on
+      if (pred_pred != nullptr) {
+        pool().put(pred);
+        pred = pred_pred;
+        continue;
+      }
+
+      if (deadline.expired()) break;
+      _mm_pause();
+    }
+
+    // Leave the line
+    // If we are last, our predecessor is last again (and our node is free)
+    // Otherwise, point our successor at our predecessor
+    auto expected = node;
+    if (tail.compare_exchange_strong(expected, pred))
+      pool().put(node);
+    else
+      node->pred.store(pred, std::memory_order_release);
+    return false;
+  }
+  using TimedLockable<AbortableCLHLock>::try_lock_until;
+
+  // Locking mechanism
+  void lock() { try_lock_until(Deadline::never()); }
+
+  // Try to grab the lock without waiting
+  // Gets in line, and leaves it right away unless the lock was free
+  bool try_lock() { return try_lock_until(Deadline(std::chrono::seconds(0))); }
+
+  // Unlocking mechanism
+  // If nobody is behind us the lock is free, otherwise release our node to
+  // our successor
+  void unlock() {
+    auto node = owner_node;
+    auto expected = node;
+    if (tail.compare_exchange_strong(expected, nullptr))
+      pool().put(node);
+    else
+      node->pred.store(available(), std::memory_order_release);
+  }
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,96 @@
+// This header contains the NUMA-aware cohort lock
+// Optimizations:
+//  1.) Hierarchical (one local lock per NUMA node, and one global lock)
+//  2.) Hand off to waiters on the same node (the global lock stays put)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "cache_line.h"
+#include "numa.h"
+#include "spinlock.h"
+
+namespace spinlocks {
+
+// Cohort Lock
+// Threads first grab the local lock for their NUMA node, then the global
+// lock. When we unlock with other threads from our node waiting, we pass the
+// global lock along with the local lock, so the global lock's cache line only
+// crosses sockets when a node runs out of waiters (or hits the batch limit)
+// GlobalLock must allow one thread to unlock what another thread locked
+// (e.g., our Spinlock and TicketLock, but not MCS)
+template <typename GlobalLock = ExpBackoffSpinlock>
+class CohortLock {
+ private:
+  // Local lock for each NUMA node (ticket lock, so we can see waiters)
+  struct alignas(kCacheLineSize) LocalLock {
+    std::atomic<std::uint32_t> line{0};
+    std::atomic<std::uint32_t> serving{0};
+
+    // Only touched by the thread holding the local lock
+    // Set when the global lock was passed to us with the local lock
+    bool global_held = false;
+    // Number of local handoffs since we took the global lock
+    int batch = 0;
+  };
+
+  // Global lock shared by all nodes
+  alignas(kCacheLineSize) GlobalLock global;
+
+  // One local lock per NUMA node
+  std::vector<LocalLock> locals;
+
+  // Max number of local handoffs before we give up the global lock
+  const int batch_limit;
+
+  // Only touched by the thread holding the lock
+  // We may migrate between lock() and unlock(), so remember our node
+  alignas(kCacheLineSize) LocalLock *owner = nullptr;
+
+ public:
+  explicit CohortLock(int batch_limit = 64)
+      : locals(num_numa_nodes()), batch_limit(batch_limit) {}
+
+  // Locking mechanism
+  void lock() {
+    auto &local = locals[current_numa_node() % locals.size()];
+
+    // Grab the lock for our node
+    auto place = local.line.fetch_add(1);
+    while (local.serving.load() != place) _mm_pause();
+
+    // Grab the global lock unless it was passed to us
+    if (!local.global_held) global.lock();
+    owner = &local;
+  }
+
+  // Unlocking mechanism
+  // Keep the global lock on our node if someone from our node is waiting
+  void unlock() {
+    auto &local = *owner;
+    auto serving = local.serving.load();
+    bool local_waiters = local.line.load() - serving > 1;
+
+    if (local_waiters && local.batch < batch_limit) {
+      // Pass the global lock along with the local lock
+      local.batch++;
+      local.global_held = true;
+    } else {
+      // Let another node have a turn
+      local.batch = 0;
+      local.global_held = false;
+      global.unlock();
+    }
+
+    // Pass the local lock to the next thread from our node
+    local.serving.store(serving + 1);
+  }
+};
+
+}  // namespace spinlocks
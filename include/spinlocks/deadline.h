@@ -0,0 +1,105 @@
+// This header contains the deadline support for timed lock attempts
+// (try_lock_for and try_lock_until)
+// Deadlines are kept in time stamp counter ticks, so checking one is an
+// rdtsc instead of a clock call
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <x86intrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+#include "pause.h"
+
+namespace spinlocks {
+
+// When a timed lock attempt gives up
+class Deadline {
+ private:
+  std::uint64_t tsc;
+
+  Deadline() : tsc(std::numeric_limits<std::uint64_t>::max()) {}
+
+ public:
+  // timeout from now
+  template <typename Rep, typename Period>
+  explicit Deadline(const std::chrono::duration<Rep, Period> &timeout) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+    tsc = __rdtsc() + ns_to_tsc(std::max<std::int64_t>(ns.count(), 0));
+  }
+
+  // Some point in time (on any clock)
+  template <typename Clock, typename Duration>
+  explicit Deadline(const std::chrono::time_point<Clock, Duration> &t)
+      : Deadline(t - Clock::now()) {}
+
+  // A deadline that never passes
+  static Deadline never() { return Deadline(); }
+
+  bool expired() const { return __rdtsc() >= tsc; }
+
+  // Nanoseconds until the deadline (0 once it has passed)
+  std::uint64_t remaining_ns() const {
+    auto now = __rdtsc();
+    if (now >= tsc) return 0;
+    return static_cast<std::uint64_t>((tsc - now) /
+                                      pause_calibration().tsc_per_ns);
+  }
+};
+
+// Exponential backoff (in nanoseconds) that never pauses past a deadline
+// Returns false instead of pausing once the deadline has passed
+template <int MinNs = 100, int MaxNs = 25600>
+class DeadlineBackoff {
+ private:
+  const Deadline &deadline;
+
+  // Start backoff at MinNs nanoseconds
+  std::uint64_t backoff_ns = MinNs;
+
+ public:
+  explicit DeadlineBackoff(const Deadline &deadline) : deadline(deadline) {}
+
+  bool operator()() {
+    auto left = deadline.remaining_ns();
+    if (left == 0) return false;
+    pause_for(std::min(backoff_ns, left));
+
+    // Get the backoff time for next time
+    backoff_ns = std::min<std::uint64_t>(backoff_ns << 1, MaxNs);
+    return true;
+  }
+};
+
+// Gives a lock the std::chrono versions of its timed lock attempts
+// (TimedLockable). The lock provides try_lock_until(const Deadline &)
+template <typename Lock>
+class TimedLockable {
+ public:
+  template <typename Rep, typename Period>
+  bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return static_cast<Lock &>(*this).try_lock_until(Deadline(timeout));
+  }
+
+  template <typename Clock, typename Duration>
+  bool try_lock_until(const std::chrono::time_point<Clock, Duration> &t) {
+    return static_cast<Lock &>(*this).try_lock_until(Deadline(t));
+  }
+};
+
+// Timed lock attempt for locks that can only try_lock() (e.g., a ticket,
+// once taken, can't be given back)
+// Keeps trying with deadline-aware backoff until the deadline
+template <typename Lock>
+bool try_lock_until_deadline(Lock &l, const Deadline &deadline) {
+  DeadlineBackoff<> backoff(deadline);
+  while (!l.try_lock())
+    if (!backoff()) return false;
+  return true;
+}
+
+}  // namespace spinlocks
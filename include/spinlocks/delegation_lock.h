@@ -0,0 +1,251 @@
+// This header contains the delegation lock (remote core locking)
+// Optimizations:
+//  1.) One server thread runs every critical section, so the protected data
+//      never leaves its cache
+//  2.) Each client has its own padded mailbox (no shared lock word)
+//  3.) Clients spin locally on their own mailbox for the result
+//  4.) Fire-and-forget submission (clients don't have to wait at all)
+//  5.) Waits (server and clients) yield the CPU after a bounded spin, so a
+//      descheduled server or client doesn't stall everyone for a timeslice
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "cache_line.h"
+
+namespace spinlocks {
+
+// Delegation Lock
+// Instead of moving the data to each thread that wants to modify it, the
+// threads send their critical sections (closures) to a server thread that
+// owns the data. Each client gets a mailbox, which is a small ring of
+// requests that only that client writes and only the server reads
+// Critical sections run one at a time on the server (just like a lock)
+class DelegationLock {
+ public:
+  // Requests a client can have in flight before post() waits
+  static constexpr std::size_t kQueueDepth = 16;
+
+  // Closures are stored in the request (no heap allocation), so they must
+  // fit in what's left of a cache line
+  static constexpr std::size_t kMaxClosureSize =
+      kCacheLineSize - sizeof(void (*)(void *));
+
+  // Pauses a waiting thread spins for before it starts yielding the CPU
+  static constexpr int kSpinsBeforeYield = 64;
+
+ private:
+  // One request (a cache line)
+  struct alignas(kCacheLineSize) Request {
+    // Runs the closure in storage, then destroys it
+    void (*run)(void *);
+    alignas(void *) unsigned char storage[kMaxClosureSize];
+  };
+
+  // Ring of requests from one client
+  struct Mailbox {
+    // Requests sent (only written by the client)
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> sent{0};
+    // Requests finished (only written by the server)
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> done{0};
+    // Set while a client owns this mailbox
+    alignas(kCacheLineSize) std::atomic<bool> in_use{false};
+    Request requests[kQueueDepth];
+  };
+
+  std::size_t max_clients;
+  std::unique_ptr<Mailbox[]> mailboxes;
+
+  // Mailboxes the server has to check (only grows)
+  std::atomic<std::size_t> num_mailboxes{0};
+
+  std::atomic<bool> stop{false};
+  std::thread server;
+
+  // Wait a little (spins is how long we've been waiting)
+  // Pause at first, then yield, so the thread we're waiting on gets to run
+  // even when it shares our CPU
+  static void relax(int &spins) {
+    if (spins < kSpinsBeforeYield) {
+      spins++;
+      _mm_pause();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  // Run everything waiting in one mailbox
+  // Returns the number of requests that ran
+  static std::size_t serve(Mailbox &m) {
+    auto done = m.done.load(std::memory_order_relaxed);
+    auto sent = m.sent.load(std::memory_order_acquire);
+    for (auto i = done; i != sent; i++) {
+      auto &r = m.requests[i % kQueueDepth];
+      r.run(r.storage);
+      // Let the client know (and reuse the slot) after each request, so
+      // synchronous clients don't wait on the rest of the batch
+      m.done.store(i + 1, std::memory_order_release);
+    }
+    return sent - done;
+  }
+
+  // Server loop
+  // Keep checking every mailbox, and drain them once we're told to stop
+  void run_server(int cpu) {
+    if (cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    int idle = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      std::size_t served = 0;
+      auto n = num_mailboxes.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < n; i++) served += serve(mailboxes[i]);
+      if (served == 0)
+        relax(idle);
+      else
+        idle = 0;
+    }
+
+    auto n = num_mailboxes.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; i++) serve(mailboxes[i]);
+  }
+
+ public:
+  // Handle a thread uses to send critical sections to the server
+  // Each client owns one mailbox until it is destroyed
+  class Client {
+   private:
+    Mailbox &m;
+
+    // Write a request into our mailbox, and return its sequence number
+    template <typename F>
+    std::uint64_t send(F &&f) {
+      using Closure = std::decay_t<F>;
+      static_assert(sizeof(Closure) <= kMaxClosureSize,
+                    "closure is too big for a request (capture less)");
+      static_assert(alignof(Closure) <= alignof(void *),
+                    "closure is over-aligned for a request");
+
+      // Only we write sent
+      auto seq = m.sent.load(std::memory_order_relaxed);
+
+      // Wait for the server if our ring is full
+      int spins = 0;
+      while (seq - m.done.load(std::memory_order_acquire) == kQueueDepth)
+        relax(spins);
+
+      auto &r = m.requests[seq % kQueueDepth];
+      new (r.storage) Closure(std::forward<F>(f));
+      r.run = [](void *p) {
+        auto *c = std::launder(static_cast<Closure *>(p));
+        (*c)();
+        c->~Closure();
+      };
+      m.sent.store(seq + 1, std::memory_order_release);
+      return seq;
+    }
+
+    // Wait until a request has finished
+    void wait(std::uint64_t seq) {
+      int spins = 0;
+      while (m.done.load(std::memory_order_acquire) <= seq) relax(spins);
+    }
+
+   public:
+    explicit Client(Mailbox &m) : m(m) {}
+    ~Client() {
+      flush();
+      m.in_use.store(false, std::memory_order_release);
+    }
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    // Run op on the server, and return what it returns
+    template <typename Op>
+    auto execute(Op op) -> decltype(op()) {
+      using Result = decltype(op());
+      if constexpr (std::is_void_v<Result>) {
+        wait(send([&op] { op(); }));
+      } else if constexpr (std::is_reference_v<Result>) {
+        // The server writes the address of what op returned a reference to
+        std::remove_reference_t<Result> *result = nullptr;
+        wait(send([&op, &result] {
+          auto &&r = op();
+          result = &r;
+        }));
+        return static_cast<Result>(*result);
+      } else {
+        // The server constructs our result on our stack (so Result doesn't
+        // have to be default-constructible)
+        std::optional<Result> result;
+        wait(send([&op, &result] { result.emplace(op()); }));
+        return std::move(*result);
+      }
+    }
+
+    // Run op on the server without waiting for it (fire-and-forget)
+    // op is copied into the request, so it can't capture by reference
+    // anything that goes away before flush()
+    template <typename Op>
+    void post(Op &&op) {
+      send(std::forward<Op>(op));
+    }
+
+    // Wait for every request we have sent
+    void flush() {
+      auto sent = m.sent.load(std::memory_order_relaxed);
+      if (sent != 0) wait(sent - 1);
+    }
+  };
+
+  // Start the server thread (pinned to cpu, unless it is negative)
+  // max_clients is the most clients that can be connected at once
+  explicit DelegationLock(int cpu = -1, std::size_t max_clients = 256)
+      : max_clients(max_clients), mailboxes(new Mailbox[max_clients]) {
+    server = std::thread([this, cpu] { run_server(cpu); });
+  }
+
+  ~DelegationLock() {
+    stop.store(true);
+    server.join();
+  }
+
+  // Get a mailbox for the calling thread
+  // Returns the first free mailbox (waits if every mailbox is taken)
+  Client connect() {
+    while (1) {
+      for (std::size_t i = 0; i < max_clients; i++) {
+        if (mailboxes[i].in_use.load(std::memory_order_relaxed) ||
+            mailboxes[i].in_use.exchange(true, std::memory_order_acquire))
+          continue;
+
+        // Make sure the server checks this mailbox
+        auto n = num_mailboxes.load();
+        while (n < i + 1 && !num_mailboxes.compare_exchange_weak(n, i + 1))
+          ;
+        return Client(mailboxes[i]);
+      }
+      std::this_thread::yield();
+    }
+  }
+};
+
+}  // namespace spinlocks
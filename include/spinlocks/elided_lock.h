@@ -0,0 +1,138 @@
+// This header contains hardware lock elision (Intel TSX/RTM)
+// Optimizations:
+//  1.) Run the critical section as a hardware transaction without taking
+//      the lock, so critical sections that touch different data run in
+//      parallel
+//  2.) Fall back to the real lock after a few aborts (or right away on
+//      aborts that won't go away by retrying)
+//  3.) RTM is detected at runtime (CPUID), so this runs everywhere
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#include <cstdint>
+
+#include "spinlock.h"
+
+namespace spinlocks {
+
+// Does this CPU support RTM? (CPUID leaf 7, EBX bit 11)
+inline bool rtm_supported() {
+  static const bool supported = [] {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ebx & (1u << 11)) != 0;
+  }();
+  return supported;
+}
+
+// RTM intrinsics without compiling everything with -mrtm
+// Only called once rtm_supported() says they exist
+__attribute__((target("rtm"))) inline unsigned rtm_begin() {
+  return _xbegin();
+}
+__attribute__((target("rtm"))) inline void rtm_end() { _xend(); }
+__attribute__((target("rtm"))) inline bool rtm_test() { return _xtest(); }
+
+// Abort code we use when the lock is held inside a transaction
+constexpr unsigned kLockBusy = 0xff;
+__attribute__((target("rtm"))) inline void rtm_abort_lock_busy() {
+  _xabort(kLockBusy);
+}
+
+// Elision counts for the calling thread (across every ElidedLock)
+// Only written outside of transactions (a write in a transaction would be
+// rolled back on abort)
+struct ElisionStats {
+  // Transactions started and committed
+  std::uint64_t attempts = 0;
+  std::uint64_t commits = 0;
+  // Why transactions aborted:
+  //  1.) Someone really held the lock
+  //  2.) Another core touched our data
+  //  3.) Our data didn't fit in the cache
+  //  4.) Anything else (e.g., interrupts, system calls, some instructions)
+  std::uint64_t lock_busy = 0;
+  std::uint64_t conflict = 0;
+  std::uint64_t capacity = 0;
+  std::uint64_t other = 0;
+  // Times we took the real lock
+  std::uint64_t fallbacks = 0;
+};
+
+// Elision counts for the calling thread
+inline ElisionStats &thread_elision_stats() {
+  thread_local ElisionStats s;
+  return s;
+}
+
+// Elided Lock
+// Wraps a lock that has is_locked() (e.g., any Spinlock). Inside the
+// transaction we read the lock word, so a thread that really takes the lock
+// writes it and aborts every transaction running on top of it
+template <typename Lock = ExpBackoffSpinlock, int MaxRetries = 3>
+class ElidedLock {
+ private:
+  Lock l;
+
+  // Try to run the critical section as a transaction
+  // Returns true if we are now inside a transaction
+  bool try_elide() {
+    auto &s = thread_elision_stats();
+    for (int attempt = 0; attempt < MaxRetries; attempt++) {
+      // Don't start a transaction that the holder will just abort
+      while (l.is_locked()) _mm_pause();
+
+      s.attempts++;
+      unsigned status = rtm_begin();
+      if (status == _XBEGIN_STARTED) {
+        // Put the lock in our read set (and make sure nobody holds it)
+        if (!l.is_locked()) return true;
+        rtm_abort_lock_busy();
+      }
+
+      // Sort out why we aborted
+      if ((status & _XABORT_EXPLICIT) &&
+          _XABORT_CODE(status) == kLockBusy) {
+        s.lock_busy++;
+      } else if (status & _XABORT_CONFLICT) {
+        s.conflict++;
+      } else if (status & _XABORT_CAPACITY) {
+        // Retrying won't make our data fit
+        s.capacity++;
+        return false;
+      } else {
+        s.other++;
+        // The CPU hints when retrying is pointless (e.g., an instruction
+        // that always aborts)
+        if (!(status & _XABORT_RETRY)) return false;
+      }
+    }
+    return false;
+  }
+
+ public:
+  // Locking mechanism
+  void lock() {
+    if (rtm_supported() && try_elide()) return;
+    thread_elision_stats().fallbacks++;
+    l.lock();
+  }
+
+  // Unlocking mechanism
+  // If we are in a transaction we never took the lock, so just commit
+  void unlock() {
+    if (rtm_supported() && rtm_test()) {
+      rtm_end();
+      thread_elision_stats().commits++;
+    } else {
+      l.unlock();
+    }
+  }
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,136 @@
+// This header contains the flat-combining executor
+// Optimizations:
+//  1.) Threads publish operations instead of grabbing the lock themselves
+//  2.) One thread (the combiner) runs every pending operation in a batch,
+//      so the protected data stays in its cache
+//  3.) Waiters spin on their own request (not the lock)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cache_line.h"
+
+namespace spinlocks {
+
+// Flat Combining
+// For short critical sections, most of the cost of a lock is moving the lock
+// and the data between cores. Instead, each thread writes its operation into
+// a slot and waits. Whoever grabs the combiner flag runs every published
+// operation, so the data only moves when the combiner changes
+// Operations run one at a time (just like a critical section)
+class FlatCombiner {
+ private:
+  // One published operation (lives on the caller's stack)
+  struct Request {
+    void (*run)(void *);
+    void *op;
+    // Set by the combiner once the operation has run
+    std::atomic<bool> done{false};
+  };
+
+  // Where threads publish operations (nullptr when empty)
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<Request *> request{nullptr};
+  };
+
+  // Set while a thread is combining
+  alignas(kCacheLineSize) std::atomic<bool> combining{false};
+
+  // One slot per core
+  std::vector<Slot> slots;
+
+  // Home slot for the calling thread
+  std::size_t my_slot() const {
+    static std::atomic<unsigned> next_slot{0};
+    thread_local unsigned slot = next_slot.fetch_add(1);
+    return slot % slots.size();
+  }
+
+  // Run every published operation (called holding the combiner flag)
+  void combine_all() {
+    for (auto &slot : slots) {
+      Request *r = slot.request.load(std::memory_order_acquire);
+      if (r == nullptr) continue;
+      r->run(r->op);
+
+      // Free the slot before waking the caller (its request is on its stack)
+      slot.request.store(nullptr, std::memory_order_relaxed);
+      r->done.store(true, std::memory_order_release);
+    }
+  }
+
+  // Grab the combiner flag if it's free, and run everything published
+  void try_combine() {
+    if (combining.load(std::memory_order_relaxed) ||
+        combining.exchange(true, std::memory_order_acquire))
+      return;
+    combine_all();
+    combining.store(false, std::memory_order_release);
+  }
+
+  // Publish call and wait until someone runs it
+  template <typename F>
+  void submit(F &call) {
+    Request r{[](void *f) { (*static_cast<F *>(f))(); }, &call};
+
+    // Use our home slot, or the next free one if another thread has it
+    // (more threads than slots)
+    auto i = my_slot();
+    while (1) {
+      Request *expected = nullptr;
+      if (slots[i].request.compare_exchange_weak(expected, &r,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
+        break;
+      i = (i + 1) % slots.size();
+      if (i == my_slot()) try_combine();
+    }
+
+    // Wait for our operation to run (combining ourselves if nobody is)
+    while (!r.done.load(std::memory_order_acquire)) {
+      try_combine();
+      if (!r.done.load(std::memory_order_acquire)) _mm_pause();
+    }
+  }
+
+ public:
+  FlatCombiner() : slots(std::max(1u, std::thread::hardware_concurrency())) {}
+
+  // Run op as if it held a lock, and return what it returns
+  template <typename Op>
+  auto combine(Op &&op) -> decltype(op()) {
+    using Result = decltype(op());
+    if constexpr (std::is_void_v<Result>) {
+      auto call = [&] { op(); };
+      submit(call);
+    } else if constexpr (std::is_reference_v<Result>) {
+      // Keep the address of what op returned a reference to
+      std::remove_reference_t<Result> *result = nullptr;
+      auto call = [&] {
+        auto &&r = op();
+        result = &r;
+      };
+      submit(call);
+      return static_cast<Result>(*result);
+    } else {
+      // Let the combiner construct our result on our stack (so Result
+      // doesn't have to be default-constructible)
+      std::optional<Result> result;
+      auto call = [&] { result.emplace(op()); };
+      submit(call);
+      return std::move(*result);
+    }
+  }
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,138 @@
+// This header contains the adaptive spin-then-park lock
+// Optimizations:
+//  1.) Spin with exponential backoff for a bounded budget
+//  2.) Self-tuning spin budget
+//  3.) Sleep in the kernel (futex) once the budget runs out
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "spinlock.h"
+
+namespace spinlocks {
+
+// Sleep until someone wakes us (if *addr still equals val)
+inline void futex_wait(std::atomic<std::uint32_t> &addr, std::uint32_t val) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&addr),
+          FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+}
+
+// Same as futex_wait, but give up after ns nanoseconds
+inline void futex_wait_for(std::atomic<std::uint32_t> &addr, std::uint32_t val,
+                           std::uint64_t ns) {
+  timespec timeout;
+  timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+  timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&addr),
+          FUTEX_WAIT_PRIVATE, val, &timeout, nullptr, 0);
+}
+
+// Wake up to count threads sleeping on addr
+inline void futex_wake(std::atomic<std::uint32_t> &addr, int count) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&addr),
+          FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+// Adaptive Lock
+// Spinning forever burns whole timeslices when threads outnumber cores (or
+// the holder gets preempted). We spin with backoff for a while, then sleep
+// on a futex. Unlock only makes a syscall when someone might be sleeping
+// The spin budget tracks how long spinning actually took to get the lock:
+//  1.) Getting the lock while spinning moves the budget toward that length
+//  2.) Running out of budget (and sleeping) shrinks it
+template <typename BackoffPolicy = ExpBackoff<4, 1024>,
+          int MaxSpinRounds = 16>
+class FutexLock
+    : public TimedLockable<FutexLock<BackoffPolicy, MaxSpinRounds>> {
+ private:
+  // Lock state:
+  //  1.) 0 - Free
+  //  2.) 1 - Locked, nobody sleeping
+  //  3.) 2 - Locked, someone might be sleeping
+  std::atomic<std::uint32_t> state{0};
+
+  // Spin budget in backoff rounds (fixed point, 1/16th of a round)
+  static constexpr int kScale = 16;
+  std::atomic<int> spin_budget{MaxSpinRounds * kScale / 2};
+
+  // Move the spin budget 1/8th of the way toward target
+  void tune(int budget, int target) {
+    spin_budget.store(budget + (target - budget) / 8,
+                      std::memory_order_relaxed);
+  }
+
+ public:
+  // Locking mechanism
+  void lock() {
+    // Fast path: the lock is free
+    std::uint32_t expected = 0;
+    if (state.compare_exchange_strong(expected, 1)) return;
+
+    // Spin for up to twice the budget (always spin a little)
+    int budget = spin_budget.load(std::memory_order_relaxed);
+    int max_rounds = std::min(2 * budget / kScale + 1, MaxSpinRounds);
+    BackoffPolicy backoff;
+    for (int round = 0; round < max_rounds; round++) {
+      backoff();
+      expected = 0;
+      if (state.load() == 0 && state.compare_exchange_strong(expected, 1)) {
+        tune(budget, (round + 1) * kScale);
+        return;
+      }
+    }
+    tune(budget, 0);
+
+    // Mark the lock as having sleepers, and sleep until it is free
+    // If we grab the lock here, we keep it marked (others may be sleeping)
+    while (state.exchange(2) != 0) futex_wait(state, 2);
+  }
+
+  // Try to grab the lock once (never waits)
+  bool try_lock() {
+    std::uint32_t expected = 0;
+    return state.compare_exchange_strong(expected, 1);
+  }
+
+  // Keep trying until the deadline
+  // Same as lock(), but the spinning and the sleeping stop at the deadline
+  bool try_lock_until(const Deadline &deadline) {
+    if (try_lock()) return true;
+
+    // Spin for up to twice the budget (never past the deadline)
+    int budget = spin_budget.load(std::memory_order_relaxed);
+    int max_rounds = std::min(2 * budget / kScale + 1, MaxSpinRounds);
+    DeadlineBackoff<> backoff(deadline);
+    for (int round = 0; round < max_rounds; round++) {
+      if (!backoff()) return false;
+      std::uint32_t expected = 0;
+      if (state.load() == 0 && state.compare_exchange_strong(expected, 1))
+        return true;
+    }
+
+    // Sleep until the lock is free or the deadline passes
+    while (state.exchange(2) != 0) {
+      auto ns = deadline.remaining_ns();
+      if (ns == 0) return false;
+      futex_wait_for(state, 2, ns);
+    }
+    return true;
+  }
+  using TimedLockable<FutexLock>::try_lock_until;
+
+  // Unlocking mechanism
+  // Only wake someone if they might be sleeping
+  void unlock() {
+    if (state.exchange(0) == 2) futex_wake(state, 1);
+  }
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,85 @@
+// This header contains a small log-linear (HDR-style) histogram
+// Used for lock wait times (in cycles)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace spinlocks {
+
+// Log-linear histogram
+// Values are grouped by power of two, and each power of two is split into
+// kSubBuckets linear buckets, so a bucket is never more than 1/kSubBuckets
+// (12.5%) wider than the values in it. Covers every 64-bit value
+class Histogram {
+ public:
+  static constexpr int kSubBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBits;
+  static constexpr int kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+  // Bucket a value falls into
+  static int bucket(std::uint64_t v) {
+    // Small values get a bucket each
+    if (v < kSubBuckets) return static_cast<int>(v);
+
+    // Power of two (above kSubBits) and the next kSubBits bits under it
+    int shift = 63 - __builtin_clzll(v) - kSubBits;
+    return (shift + 1) * kSubBuckets +
+           static_cast<int>((v >> shift) & (kSubBuckets - 1));
+  }
+
+  // Smallest value that falls into a bucket
+  static std::uint64_t bucket_min(int b) {
+    if (b < kSubBuckets) return b;
+    int shift = b / kSubBuckets - 1;
+    return static_cast<std::uint64_t>(kSubBuckets + b % kSubBuckets) << shift;
+  }
+
+  // Largest value that falls into a bucket
+  static std::uint64_t bucket_max(int b) {
+    return b + 1 == kBuckets ? UINT64_MAX : bucket_min(b + 1) - 1;
+  }
+
+  void record(std::uint64_t v) { add(bucket(v), 1, v); }
+
+  // Add n values to a bucket (max is the largest of them)
+  void add(int b, std::uint64_t n, std::uint64_t max) {
+    counts[b] += n;
+    total += n;
+    max_value = std::max(max_value, max);
+  }
+
+  void merge(const Histogram &other) {
+    for (int b = 0; b < kBuckets; b++) counts[b] += other.counts[b];
+    total += other.total;
+    max_value = std::max(max_value, other.max_value);
+  }
+
+  std::uint64_t count() const { return total; }
+  std::uint64_t max() const { return max_value; }
+
+  // Value at a percentile (0-100)
+  // Reports the top of the bucket, so this never underestimates
+  std::uint64_t percentile(double p) const {
+    if (total == 0) return 0;
+    auto rank = static_cast<std::uint64_t>(p / 100.0 * total);
+    rank = std::clamp<std::uint64_t>(rank, 1, total);
+
+    std::uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; b++) {
+      seen += counts[b];
+      if (seen >= rank) return std::min(bucket_max(b), max_value);
+    }
+    return max_value;
+  }
+
+ private:
+  std::array<std::uint64_t, kBuckets> counts{};
+  std::uint64_t total = 0;
+  std::uint64_t max_value = 0;
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,95 @@
+// This header contains the MCS queue lock
+// Optimizations:
+//  1.) Ticket-style fairness (FIFO queue)
+//  2.) Each waiter spins on its own cache line
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <atomic>
+
+#include "cache_line.h"
+#include "ordering.h"
+
+namespace spinlocks {
+
+// MCS Lock
+// Waiters form a linked list (queue) of nodes
+// Each waiter spins on the flag in its own node, and the holder hands the
+// lock directly to its successor, so each unlock only touches one waiter
+// Ordering says which memory orderings to use (see ordering.h)
+template <typename Ordering = SeqCstOrdering>
+class BasicMCSLock {
+ public:
+  // Each thread brings a node when it grabs the lock
+  // Nodes are padded to a cache line so waiters never share a line
+  struct alignas(kCacheLineSize) Node {
+    // Next waiter in line
+    std::atomic<Node *> next{nullptr};
+    // Set while we wait for our predecessor to hand us the lock
+    std::atomic<bool> locked{false};
+  };
+
+  // Holds the lock for the current scope
+  // The node lives on the stack (no heap allocation)
+  class Guard {
+   private:
+    BasicMCSLock &l;
+    Node node;
+
+   public:
+    explicit Guard(BasicMCSLock &l) : l(l) { l.lock(node); }
+    ~Guard() { l.unlock(node); }
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+  };
+
+ private:
+  // Lock is just the last node in line (nullptr when the lock is free)
+  alignas(kCacheLineSize) std::atomic<Node *> tail{nullptr};
+
+ public:
+  // Locking mechanism
+  void lock(Node &node) {
+    // Our node is published by the exchange below
+    node.next.store(nullptr, Ordering::relaxed);
+    node.locked.store(true, Ordering::relaxed);
+
+    // Get in line behind whoever was last
+    // If nobody was in line, we have the lock
+    Node *prev = tail.exchange(&node, Ordering::acq_rel);
+    if (prev == nullptr) return;
+
+    // Let our predecessor know where we are, then spin on our own node
+    prev->next.store(&node, Ordering::release);
+    while (node.locked.load(Ordering::acquire)) _mm_pause();
+  }
+
+  // Unlocking mechanism
+  // Pass the lock directly to the next node in line
+  void unlock(Node &node) {
+    Node *succ = node.next.load(Ordering::acquire);
+    if (succ == nullptr) {
+      // If we are still the last node, nobody is waiting and the lock is free
+      Node *expected = &node;
+      if (tail.compare_exchange_strong(expected, nullptr, Ordering::release,
+                                       Ordering::relaxed))
+        return;
+
+      // Someone got in line but has not linked themselves in yet
+      while ((succ = node.next.load(Ordering::acquire)) == nullptr)
+        _mm_pause();
+    }
+    succ->locked.store(false, Ordering::release);
+  }
+};
+
+// Queue lock from the MCS benchmark
+using MCSLock = BasicMCSLock<>;
+
+// The same lock with the minimum memory orderings
+using AcqRelMCSLock = BasicMCSLock<AcqRelOrdering>;
+
+}  // namespace spinlocks
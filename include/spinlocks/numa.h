@@ -0,0 +1,64 @@
+// This header contains helpers for finding which NUMA node we are on
+// Nodes come from getcpu and /sys/devices/system/node
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <sched.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace spinlocks {
+
+// Parse a sysfs list of CPUs or nodes (e.g., "0-3,8-11")
+inline std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> ids;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) continue;
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int i = first; i <= last; i++) ids.push_back(i);
+  }
+  return ids;
+}
+
+// Read the first line of a sysfs file (empty if it does not exist)
+inline std::string read_sysfs(const std::string &path) {
+  std::ifstream f(path);
+  std::string line;
+  std::getline(f, line);
+  return line;
+}
+
+// Number of NUMA nodes (1 if the kernel does not report any)
+inline int num_numa_nodes() {
+  static const int nodes = [] {
+    auto ids = parse_cpu_list(read_sysfs("/sys/devices/system/node/online"));
+    return ids.empty() ? 1 : ids.back() + 1;
+  }();
+  return nodes;
+}
+
+// CPUs that belong to a NUMA node
+inline std::vector<int> numa_node_cpus(int node) {
+  return parse_cpu_list(read_sysfs("/sys/devices/system/node/node" +
+                                   std::to_string(node) + "/cpulist"));
+}
+
+// NUMA node of the CPU we are running on right now
+// getcpu goes through the vDSO, so this is cheap enough to call every lock()
+inline int current_numa_node() {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (getcpu(&cpu, &node) != 0) return 0;
+  return static_cast<int>(node);
+}
+
+}  // namespace spinlocks
@@ -0,0 +1,35 @@
+// This header contains the memory ordering policies for our locks
+// Locks name the weakest ordering each operation needs (acquire when we take
+// the lock, release when we hand it off, relaxed while we wait), and the
+// policy decides what that actually compiles to
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <atomic>
+
+namespace spinlocks {
+
+// Sequentially consistent everywhere (what std::atomic does by default)
+// On x86, every store is an xchg (or mov + mfence), including unlock
+struct SeqCstOrdering {
+  static constexpr auto relaxed = std::memory_order_seq_cst;
+  static constexpr auto acquire = std::memory_order_seq_cst;
+  static constexpr auto release = std::memory_order_seq_cst;
+  static constexpr auto acq_rel = std::memory_order_seq_cst;
+};
+
+// The minimum a lock needs
+// Taking the lock is an acquire (the critical section can't move above it),
+// and releasing it is a release (the critical section can't move below it).
+// Spinning on the lock word is relaxed (the acquire comes from the
+// read-modify-write that actually takes the lock)
+// On x86, unlock becomes a plain mov
+struct AcqRelOrdering {
+  static constexpr auto relaxed = std::memory_order_relaxed;
+  static constexpr auto acquire = std::memory_order_acquire;
+  static constexpr auto release = std::memory_order_release;
+  static constexpr auto acq_rel = std::memory_order_acq_rel;
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,114 @@
+// This header contains the calibrated, time-based pause primitives
+// How long a pause takes changes a lot between CPU generations (over 10x),
+// so backing off for N pauses means something different on every machine.
+// We measure it once, so backoff can be given in nanoseconds
+// On CPUs with WAITPKG we use tpause and umonitor/umwait instead
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <x86intrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace spinlocks {
+
+// What we measured about this machine
+struct PauseCalibration {
+  // Time stamp counter ticks per nanosecond
+  double tsc_per_ns;
+  // Time stamp counter ticks for one pause
+  double tsc_per_pause;
+};
+
+// Measure the time stamp counter against the steady clock, and the cost of
+// a pause against the time stamp counter
+// Assumes an invariant time stamp counter (constant_tsc and nonstop_tsc)
+inline PauseCalibration calibrate_pause() {
+  using namespace std::chrono;
+
+  // Count ticks over a couple of milliseconds
+  auto start = steady_clock::now();
+  auto tsc_start = __rdtsc();
+  while (steady_clock::now() - start < milliseconds(2))
+    ;
+  auto tsc_end = __rdtsc();
+  auto ns = duration<double, std::nano>(steady_clock::now() - start).count();
+
+  // Time a batch of pauses a few times, and keep the fastest (the others
+  // were probably interrupted)
+  constexpr int kPauses = 256;
+  std::uint64_t best = UINT64_MAX;
+  for (int trial = 0; trial < 16; trial++) {
+    auto t0 = __rdtsc();
+    for (int i = 0; i < kPauses; i++) _mm_pause();
+    auto t1 = __rdtsc();
+    best = std::min<std::uint64_t>(best, t1 - t0);
+  }
+
+  PauseCalibration c;
+  c.tsc_per_ns = (tsc_end - tsc_start) / ns;
+  c.tsc_per_pause = std::max(1.0, static_cast<double>(best) / kPauses);
+  return c;
+}
+
+// Calibration for this machine (measured the first time it's needed)
+// Call it before timing anything (the benchmark harness does), or the first
+// backoff pays for the measurement
+inline const PauseCalibration &pause_calibration() {
+  static const PauseCalibration c = calibrate_pause();
+  return c;
+}
+
+// Does this CPU support WAITPKG? (CPUID leaf 7, ECX bit 5)
+inline bool waitpkg_supported() {
+  static const bool supported = [] {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ecx & (1u << 5)) != 0;
+  }();
+  return supported;
+}
+
+// WAITPKG intrinsics without compiling everything with -mwaitpkg
+// Only called once waitpkg_supported() says they exist
+// Control 1 picks the lighter sleep state (C0.1), which wakes up faster
+__attribute__((target("waitpkg"))) inline void tpause_until(
+    std::uint64_t tsc) {
+  _tpause(1, tsc);
+}
+__attribute__((target("waitpkg"))) inline void umonitor(const void *addr) {
+  _umonitor(const_cast<void *>(addr));
+}
+__attribute__((target("waitpkg"))) inline void umwait_until(
+    std::uint64_t tsc) {
+  _umwait(1, tsc);
+}
+
+// Number of pauses that take about ns nanoseconds
+inline int pause_iters_for(std::uint64_t ns) {
+  auto &c = pause_calibration();
+  return static_cast<int>(ns * c.tsc_per_ns / c.tsc_per_pause);
+}
+
+// Convert nanoseconds to time stamp counter ticks
+inline std::uint64_t ns_to_tsc(std::uint64_t ns) {
+  return static_cast<std::uint64_t>(ns * pause_calibration().tsc_per_ns);
+}
+
+// Wait for about ns nanoseconds
+// Uses tpause when we have it (the core idles instead of spinning)
+inline void pause_for(std::uint64_t ns) {
+  if (waitpkg_supported()) {
+    tpause_until(__rdtsc() + ns_to_tsc(ns));
+  } else {
+    for (int i = pause_iters_for(ns); i > 0; i--) _mm_pause();
+  }
+}
+
+}  // namespace spinlocks
@@ -0,0 +1,166 @@
+// This header contains the reader-writer spinlocks
+// Optimizations:
+//  1.) Readers share the lock
+//  2.) Writer preference (waiting writers block new readers)
+//  3.) Spin locally with backoff
+//  4.) Per-thread reader slots (scalable version)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "cache_line.h"
+#include "spinlock.h"
+
+namespace spinlocks {
+
+// Reader-writer spinlock
+// Lock is a single word:
+//  1.) Bit 0 - A writer holds the lock
+//  2.) Bits 1-15 - Number of writers waiting (new readers back off while
+//      any writer is waiting)
+//  3.) Bits 16-31 - Number of readers holding the lock
+// Same interface as std::shared_mutex (works with std::shared_lock)
+template <typename BackoffPolicy = ExpBackoff<4, 1024>>
+class RWSpinlock {
+ private:
+  static constexpr std::uint32_t kWriter = 1;
+  static constexpr std::uint32_t kWaiter = 2;
+  static constexpr std::uint32_t kWaiterMask = 0xfffe;
+  static constexpr std::uint32_t kReader = 1 << 16;
+  static constexpr std::uint32_t kReaderMask = 0xffff0000;
+
+  std::atomic<std::uint32_t> state{0};
+
+ public:
+  // Locking mechanism (exclusive)
+  void lock() {
+    // Grab the lock right away if nobody has it or wants it
+    std::uint32_t s = 0;
+    if (state.compare_exchange_strong(s, kWriter)) return;
+
+    // Stop new readers from getting in ahead of us
+    // We stay counted until we get the lock, so a writer that gets in first
+    // can't let readers past us when it unlocks
+    state.fetch_add(kWaiter);
+
+    BackoffPolicy backoff;
+    while (1) {
+      // Grab the lock if there are no readers or writers
+      s = state.load();
+      if ((s & (kWriter | kReaderMask)) == 0) {
+        if (state.compare_exchange_weak(s, s - kWaiter + kWriter)) return;
+        continue;
+      }
+
+      // Just read the value which gets cached locally
+      do {
+        backoff();
+      } while (state.load() & (kWriter | kReaderMask));
+    }
+  }
+
+  // Unlocking mechanism (exclusive)
+  // Leave the waiting writers alone
+  void unlock() { state.fetch_sub(kWriter); }
+
+  // Locking mechanism (shared)
+  void lock_shared() {
+    BackoffPolicy backoff;
+    while (1) {
+      // Join the other readers if no writer holds or wants the lock
+      auto s = state.load();
+      if (!(s & (kWriter | kWaiterMask))) {
+        if (state.compare_exchange_weak(s, s + kReader)) return;
+        continue;
+      }
+
+      // Just read the value which gets cached locally
+      do {
+        backoff();
+      } while (state.load() & (kWriter | kWaiterMask));
+    }
+  }
+
+  // Unlocking mechanism (shared)
+  void unlock_shared() { state.fetch_sub(kReader); }
+};
+
+// Scalable reader-writer spinlock
+// Each reader only touches its own padded slot, so concurrent readers never
+// share a cache line. Writers pay for this by checking every slot
+// Threads get a slot round-robin the first time they read, so threads pinned
+// to different cores end up on different slots
+template <typename BackoffPolicy = ExpBackoff<4, 1024>>
+class ScalableRWSpinlock {
+ private:
+  // Number of readers holding the lock through this slot
+  struct alignas(kCacheLineSize) ReaderSlot {
+    std::atomic<std::int32_t> readers{0};
+  };
+
+  // Set while a writer holds (or is waiting for) the lock
+  alignas(kCacheLineSize) std::atomic<bool> writer{false};
+
+  // One slot per core
+  std::vector<ReaderSlot> slots;
+
+  // Slot for the calling thread
+  ReaderSlot &my_slot() {
+    static std::atomic<unsigned> next_slot{0};
+    thread_local unsigned slot = next_slot.fetch_add(1);
+    return slots[slot % slots.size()];
+  }
+
+ public:
+  ScalableRWSpinlock()
+      : slots(std::max(1u, std::thread::hardware_concurrency())) {}
+
+  // Locking mechanism (exclusive)
+  void lock() {
+    BackoffPolicy backoff;
+
+    // Grab the writer flag (this also stops new readers)
+    while (writer.exchange(true)) {
+      do {
+        backoff();
+      } while (writer.load());
+    }
+
+    // Wait for the readers that got in before us to leave
+    for (auto &slot : slots)
+      while (slot.readers.load() != 0) _mm_pause();
+  }
+
+  // Unlocking mechanism (exclusive)
+  void unlock() { writer.store(false); }
+
+  // Locking mechanism (shared)
+  void lock_shared() {
+    auto &slot = my_slot();
+    BackoffPolicy backoff;
+    while (1) {
+      // Announce ourselves, then make sure no writer got in first
+      slot.readers.fetch_add(1);
+      if (!writer.load()) return;
+
+      // Writer preference: get out of the way and wait for the writer
+      slot.readers.fetch_sub(1);
+      do {
+        backoff();
+      } while (writer.load());
+    }
+  }
+
+  // Unlocking mechanism (shared)
+  void unlock_shared() { my_slot().readers.fetch_sub(1); }
+};
+
+}  // namespace spinlocks
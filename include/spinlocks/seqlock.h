@@ -0,0 +1,134 @@
+// This header contains the sequence lock (seqlock)
+// Optimizations:
+//  1.) Readers never write shared memory (no lock word exchange)
+//  2.) Readers retry instead of blocking writers
+//  3.) Writers are serialized with one of our spinlocks
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "cache_line.h"
+#include "spinlock.h"
+
+namespace spinlocks {
+
+// Sequence Lock
+// Writers bump a sequence number before and after each write (odd while a
+// write is in progress). Readers read the sequence number, read the data,
+// and check that the sequence number didn't change. If it did, a write
+// overlapped and they try again
+// The data has to be read with acquire atomics and written with release
+// atomics (see Seqlocked below). That keeps the data reads above the retry
+// check and the data writes below the first bump, and a read that gets
+// thrown away is never a data race. On x86 both are plain moves (and unlike
+// fences, ThreadSanitizer understands them)
+template <typename WriterLock = ExpBackoffSpinlock>
+class Seqlock {
+ private:
+  alignas(kCacheLineSize) std::atomic<std::uint32_t> seq{0};
+  WriterLock writer;
+
+ public:
+  // Start a read (waits out a write in progress)
+  std::uint32_t read_begin() const {
+    while (1) {
+      auto s = seq.load(std::memory_order_acquire);
+      if ((s & 1) == 0) return s;
+      _mm_pause();
+    }
+  }
+
+  // Did a write overlap the read that started at s?
+  bool read_retry(std::uint32_t s) const {
+    return seq.load(std::memory_order_relaxed) != s;
+  }
+
+  // Locking mechanism (writers)
+  void lock() {
+    writer.lock();
+    seq.store(seq.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+  }
+
+  // Unlocking mechanism (writers)
+  void unlock() {
+    seq.store(seq.load(std::memory_order_relaxed) + 1,
+              std::memory_order_release);
+    writer.unlock();
+  }
+};
+
+// Value protected by a seqlock
+// The value is kept as 8-byte atomic words that are read with acquire and
+// written with release atomics, so a read that overlaps a write is thrown
+// away without ever being a data race. T must be trivially copyable (we
+// copy it a word at a time) and default constructible
+template <typename T, typename WriterLock = ExpBackoffSpinlock>
+class Seqlocked {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Seqlocked values are copied a word at a time");
+
+ private:
+  static constexpr std::size_t kWords =
+      (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  Seqlock<WriterLock> l;
+  std::atomic<std::uint64_t> words[kWords];
+
+  // Copy value into the words (holding the writer lock)
+  void write_words(const T &value) {
+    std::uint64_t buf[kWords] = {};
+    std::memcpy(buf, &value, sizeof(T));
+    for (std::size_t i = 0; i < kWords; i++)
+      words[i].store(buf[i], std::memory_order_release);
+  }
+
+  // Copy the words into a value
+  T read_words() const {
+    std::uint64_t buf[kWords];
+    for (std::size_t i = 0; i < kWords; i++)
+      buf[i] = words[i].load(std::memory_order_acquire);
+    T value;
+    std::memcpy(&value, buf, sizeof(T));
+    return value;
+  }
+
+ public:
+  explicit Seqlocked(const T &value = T{}) { write_words(value); }
+
+  // Get a consistent copy (retries if a write overlaps)
+  T load() const {
+    while (1) {
+      auto s = l.read_begin();
+      T value = read_words();
+      if (!l.read_retry(s)) return value;
+    }
+  }
+
+  // Replace the value
+  void store(const T &value) {
+    l.lock();
+    write_words(value);
+    l.unlock();
+  }
+
+  // Change the value in place (f takes a T&)
+  template <typename F>
+  void update(F f) {
+    l.lock();
+    T value = read_words();
+    f(value);
+    write_words(value);
+    l.unlock();
+  }
+};
+
+}  // namespace spinlocks
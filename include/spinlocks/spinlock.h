@@ -0,0 +1,487 @@
+// This header contains the policy-based spinlock used by every benchmark
+// A Spinlock is built from four policies:
+//  1.) Acquire - How we try and grab the lock
+//  2.) Wait - What we do after we fail to grab the lock
+//  3.) Backoff - How long we pause while waiting
+//  4.) Ordering - Which memory orderings the lock word uses (ordering.h)
+// Everything is resolved at compile time, so each combination compiles down
+// to the same loop as the hand-written versions
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+#include <x86intrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "cache_line.h"
+#include "deadline.h"
+#include "ordering.h"
+#include "pause.h"
+#include "stats.h"
+
+namespace spinlocks {
+
+// Acquire policies
+// Ordering says which memory orderings to use (see ordering.h)
+
+// Exchange will return the previous value of the lock
+// If the lock was free (false), it is now set to true and we own it
+struct ExchangeAcquire {
+  template <typename Ordering = SeqCstOrdering>
+  static bool try_acquire(std::atomic<bool> &locked) {
+    return !locked.exchange(true, Ordering::acquire);
+  }
+};
+
+// Compare-and-swap only writes the lock if it is currently free
+struct CompareExchangeAcquire {
+  template <typename Ordering = SeqCstOrdering>
+  static bool try_acquire(std::atomic<bool> &locked) {
+    bool expected = false;
+    return locked.compare_exchange_strong(expected, true, Ordering::acquire,
+                                          Ordering::relaxed);
+  }
+};
+
+// Wait policies
+// Each returns the number of iterations it spent in backoff
+// Timed attempts pass a stop check (e.g., "has the deadline passed?") that
+// ends the wait early. lock() passes NeverStop, which compiles away
+
+// Wait until the lock looks free
+struct NeverStop {
+  constexpr bool operator()() const { return false; }
+};
+
+// Go straight back to trying to grab the lock (naive spinlock)
+// Every attempt is a write, so the cache line bounces between cores
+struct SpinOnAcquire {
+  template <typename Ordering = SeqCstOrdering, typename Backoff,
+            typename Stop = NeverStop>
+  static std::uint64_t wait(std::atomic<bool> &, Backoff &backoff,
+                            Stop = {}) {
+    return backoff();
+  }
+};
+
+// Just read the value which gets cached locally until the lock looks free
+// This leads to less traffic
+struct SpinLocally {
+  template <typename Ordering = SeqCstOrdering, typename Backoff,
+            typename Stop = NeverStop>
+  static std::uint64_t wait(std::atomic<bool> &locked, Backoff &backoff,
+                            Stop stop = {}) {
+    std::uint64_t paused = 0;
+    do {
+      // Pause between each check of the lock
+      paused += backoff();
+    } while (locked.load(Ordering::relaxed) && !stop());
+    return paused;
+  }
+};
+
+// Sleep until the lock word changes (WAITPKG umonitor/umwait)
+// Falls back to SpinLocally on CPUs without WAITPKG
+// We still back off once, so waiters woken by the same unlock don't all
+// rush the lock at the same time
+// A stop check is made each time we wake up (at most kMaxSleepNs apart)
+struct MonitorWait {
+  // Longest we sleep before checking the lock again
+  static constexpr std::uint64_t kMaxSleepNs = 10000;
+
+  template <typename Ordering = SeqCstOrdering, typename Backoff,
+            typename Stop = NeverStop>
+  static std::uint64_t wait(std::atomic<bool> &locked, Backoff &backoff,
+                            Stop stop = {}) {
+    if (!waitpkg_supported())
+      return SpinLocally::wait<Ordering>(locked, backoff, stop);
+
+    std::uint64_t paused = backoff();
+    while (locked.load(Ordering::relaxed) && !stop()) {
+      umonitor(&locked);
+      // The lock may have been released before we started monitoring
+      if (!locked.load(Ordering::relaxed)) break;
+      umwait_until(__rdtsc() + ns_to_tsc(kMaxSleepNs));
+    }
+    return paused;
+  }
+};
+
+// Backoff policies
+// A new backoff object is created for every call to lock()
+// (AdaptiveBackoff below also keeps state in the lock)
+// Each call returns the number of iterations it paused for
+
+// Don't pause at all
+struct NoBackoff {
+  int operator()() { return 0; }
+};
+
+// Burn some number of iterations in a loop
+// Volatile keeps the compiler from removing the loop
+template <int Iters>
+struct ActiveBackoff {
+  int operator()() {
+    for (volatile int i = 0; i < Iters; i += 1)
+      ;
+    return Iters;
+  }
+};
+
+// Pause for some number of iterations
+// How many times you should pause should be experimentally determined
+template <int Iters>
+struct PassiveBackoff {
+  int operator()() {
+    for (int i = 0; i < Iters; i++) _mm_pause();
+    return Iters;
+  }
+};
+
+// Pause for an exponentially increasing number of iterations
+template <int MinIters, int MaxIters>
+class ExpBackoff {
+ private:
+  // Start backoff at MinIters iterations
+  int backoff_iters = MinIters;
+
+ public:
+  int operator()() {
+    // Pause for some number of iterations
+    int paused = backoff_iters;
+    for (int i = 0; i < paused; i++) _mm_pause();
+
+    // Get the backoff iterations for next time
+    backoff_iters = std::min(backoff_iters << 1, MaxIters);
+    return paused;
+  }
+};
+
+// Pause for an exponentially increasing amount of time (in nanoseconds)
+// Same as ExpBackoff, but the window means the same thing on every CPU
+// (see pause.h). Uses tpause on CPUs with WAITPKG
+template <int MinNs, int MaxNs>
+class TimedBackoff {
+ private:
+  // Start backoff at MinNs nanoseconds
+  int backoff_ns = MinNs;
+
+ public:
+  int operator()() {
+    // Pause for some amount of time
+    int ns = backoff_ns;
+    pause_for(ns);
+
+    // Get the backoff time for next time
+    backoff_ns = std::min(backoff_ns << 1, MaxNs);
+    return pause_iters_for(ns);
+  }
+};
+
+// Random number for the calling thread (xorshift32)
+// State is 4 bytes of thread-local storage, so waiters never share it, and
+// there is no allocation or locking
+inline std::uint32_t thread_random() {
+  thread_local std::uint32_t x = 0;
+
+  // Seed each thread differently the first time (must not be zero)
+  if (x == 0) {
+    auto seed = __rdtsc() ^ reinterpret_cast<std::uintptr_t>(&x);
+    x = static_cast<std::uint32_t>(seed ^ (seed >> 32)) | 1;
+  }
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+// Pause for a random number of iterations (between MinIters and MaxIters)
+template <int MinIters, int MaxIters>
+struct RandomBackoff {
+  int operator()() {
+    // Scale the random number into our range (multiply and shift)
+    constexpr std::uint64_t range = MaxIters - MinIters + 1;
+    int backoff_iters =
+        MinIters + static_cast<int>((thread_random() * range) >> 32);
+
+    // Pause for some number of iterations
+    for (int i = 0; i < backoff_iters; i++) _mm_pause();
+    return backoff_iters;
+  }
+};
+
+// Exponential backoff that learns its window at runtime
+// Every contended acquisition reports how many attempts failed and how long
+// it took (rdtsc). Every kEpoch contended acquisitions, the lock holder:
+//  1.) Raises the min iterations if waiters keep losing the race for the
+//      lock after backing off, and lowers it if they rarely do
+//  2.) Otherwise, moves the max iterations one power of two in whichever
+//      direction lowered the average latency (hill climbing)
+// Only one knob moves per epoch, so we know which one changed the latency
+template <int InitialMinIters = 4, int InitialMaxIters = 1024>
+class AdaptiveBackoff {
+ public:
+  // Contended acquisitions between each adjustment
+  static constexpr int kEpoch = 256;
+
+  // Bounds on the window
+  static constexpr int kMinIters = 1;
+  static constexpr int kMaxIters = 1 << 16;
+
+  // Per-lock state (kept off the lock's cache line)
+  class alignas(kCacheLineSize) State {
+   private:
+    friend class AdaptiveBackoff;
+
+    // Current window (read by every waiter)
+    std::atomic<int> min_iters{InitialMinIters};
+    std::atomic<int> max_iters{InitialMaxIters};
+
+    // Only touched by the thread holding the lock
+    int acquisitions = 0;
+    std::uint64_t failed = 0;
+    std::uint64_t latency = 0;
+    double last_latency = std::numeric_limits<double>::max();
+    // Which way we are moving max iterations (1 = grow, -1 = shrink)
+    int direction = -1;
+
+   public:
+    int min() const { return min_iters.load(std::memory_order_relaxed); }
+    int max() const { return max_iters.load(std::memory_order_relaxed); }
+  };
+
+ private:
+  State &state;
+
+  // Failed attempts for this acquisition, and when the first one happened
+  int failed = 0;
+  std::uint64_t start = 0;
+
+  // Window for this acquisition
+  int backoff_iters = 0;
+  int max_iters = 0;
+
+  // Move the window based on the last epoch (called holding the lock)
+  void adjust() {
+    double avg_latency = static_cast<double>(state.latency) / kEpoch;
+    double avg_failed = static_cast<double>(state.failed) / kEpoch;
+    state.acquisitions = 0;
+    state.failed = 0;
+    state.latency = 0;
+
+    // The first attempt always fails, so more than two means waiters keep
+    // waking up at the same time and colliding
+    int min_iters = state.min();
+    int new_min = min_iters;
+    if (avg_failed > 2)
+      new_min = std::min(min_iters << 1, state.max());
+    else if (avg_failed < 1.5)
+      new_min = std::max(min_iters >> 1, kMinIters);
+    if (new_min != min_iters) {
+      state.min_iters.store(new_min, std::memory_order_relaxed);
+      // Latency from here on isn't comparable with what we saw before
+      state.last_latency = std::numeric_limits<double>::max();
+      return;
+    }
+
+    // Turn around if the last move made latency worse
+    // Hold still if it made no real difference (within 5%)
+    if (avg_latency > state.last_latency * 1.05) {
+      state.direction = -state.direction;
+    } else if (avg_latency > state.last_latency * 0.95) {
+      state.last_latency = avg_latency;
+      return;
+    }
+    state.last_latency = avg_latency;
+
+    int max_iters = state.max();
+    int new_max = state.direction > 0 ? max_iters << 1 : max_iters >> 1;
+    new_max = std::clamp(new_max, std::max(min_iters, kMinIters), kMaxIters);
+    state.max_iters.store(new_max, std::memory_order_relaxed);
+  }
+
+ public:
+  explicit AdaptiveBackoff(State &state) : state(state) {}
+
+  // Called after each failed attempt to grab the lock
+  // The window is only read once we fail (uncontended locks never touch it)
+  void failed_attempt() {
+    if (failed++ == 0) {
+      start = __rdtsc();
+      backoff_iters = state.min();
+      max_iters = state.max();
+    }
+  }
+
+  int operator()() {
+    // Pause for some number of iterations
+    int paused = backoff_iters;
+    for (int i = 0; i < paused; i++) _mm_pause();
+
+    // Get the backoff iterations for next time
+    backoff_iters = std::min(backoff_iters << 1, max_iters);
+    return paused;
+  }
+
+  // Called holding the lock
+  void acquired() {
+    if (failed == 0) return;
+    state.acquisitions++;
+    state.failed += failed;
+    state.latency += __rdtsc() - start;
+    if (state.acquisitions == kEpoch) adjust();
+  }
+};
+
+// Backoff policies that tune themselves have per-lock state (State)
+// They hear about every failed attempt and when we get the lock
+template <typename BackoffPolicy, typename = void>
+struct is_self_tuning : std::false_type {};
+template <typename BackoffPolicy>
+struct is_self_tuning<BackoffPolicy,
+                      std::void_t<typename BackoffPolicy::State>>
+    : std::true_type {};
+
+// Per-lock backoff state (empty unless the policy tunes itself)
+template <typename BackoffPolicy, bool = is_self_tuning<BackoffPolicy>::value>
+struct BackoffState {};
+template <typename BackoffPolicy>
+struct BackoffState<BackoffPolicy, true> {
+  typename BackoffPolicy::State tuning;
+};
+
+// Spinlock built from the policies above
+// Inheriting the backoff state and profiler keeps other locks a single byte
+// (both are empty unless used)
+template <typename AcquirePolicy, typename WaitPolicy, typename BackoffPolicy,
+          typename OrderingPolicy = SeqCstOrdering>
+class Spinlock : private BackoffState<BackoffPolicy>,
+                 private LockProfiler,
+                 public TimedLockable<Spinlock<AcquirePolicy, WaitPolicy,
+                                               BackoffPolicy, OrderingPolicy>> {
+ private:
+  // Lock is just an atomic bool
+  std::atomic<bool> locked{false};
+
+  // New backoff object for each call to lock()
+  // Policy calls with our memory orderings
+  bool try_acquire() {
+    return AcquirePolicy::template try_acquire<OrderingPolicy>(locked);
+  }
+  template <typename Stop = NeverStop>
+  std::uint64_t wait(BackoffPolicy &backoff, Stop stop = {}) {
+    return WaitPolicy::template wait<OrderingPolicy>(locked, backoff, stop);
+  }
+
+  BackoffPolicy make_backoff() {
+    if constexpr (is_self_tuning<BackoffPolicy>::value)
+      return BackoffPolicy(this->tuning);
+    else
+      return BackoffPolicy();
+  }
+
+ public:
+  // Locking mechanism
+  void lock() {
+    auto start = profile_start();
+    auto backoff = make_backoff();
+    std::uint64_t failed_attempts = 0;
+    std::uint64_t pause_iters = 0;
+
+    // Keep trying until we get the lock
+    while (!try_acquire()) {
+      failed_attempts++;
+      if constexpr (is_self_tuning<BackoffPolicy>::value)
+        backoff.failed_attempt();
+      pause_iters += wait(backoff);
+    }
+
+    if constexpr (is_self_tuning<BackoffPolicy>::value) backoff.acquired();
+    profile_acquired(start, failed_attempts, pause_iters);
+  }
+
+  // Try to grab the lock once (never waits)
+  // Only tries if the lock looks free, so a busy lock isn't written
+  bool try_lock() {
+    auto start = profile_start();
+    if (locked.load(std::memory_order_relaxed) || !try_acquire())
+      return false;
+    profile_acquired(start, 0, 0);
+    return true;
+  }
+
+  // Keep trying until the deadline
+  // Waits with the same wait and backoff policies as lock(), checking the
+  // deadline between pauses (so we can be late by up to one backoff pause,
+  // or one MonitorWait sleep)
+  bool try_lock_until(const Deadline &deadline) {
+    auto start = profile_start();
+    auto backoff = make_backoff();
+    auto expired = [&deadline] { return deadline.expired(); };
+    std::uint64_t failed_attempts = 0;
+    std::uint64_t pause_iters = 0;
+
+    while (!try_acquire()) {
+      failed_attempts++;
+      if (deadline.expired()) return false;
+      if constexpr (is_self_tuning<BackoffPolicy>::value)
+        backoff.failed_attempt();
+      pause_iters += wait(backoff, expired);
+    }
+
+    if constexpr (is_self_tuning<BackoffPolicy>::value) backoff.acquired();
+    profile_acquired(start, failed_attempts, pause_iters);
+    return true;
+  }
+  using TimedLockable<Spinlock>::try_lock_until;
+
+  // Unlocking mechanism
+  // Just set the lock to free (false)
+  void unlock() {
+    profile_released();
+    locked.store(false, OrderingPolicy::release);
+  }
+
+  // Is someone holding the lock? (a snapshot, used for lock elision)
+  bool is_locked() const { return locked.load(std::memory_order_relaxed); }
+
+  // Backoff state (only for self-tuning backoff policies)
+  const auto &backoff_state() const { return this->tuning; }
+
+  // Contention profile (empty unless SPINLOCKS_STATS is defined)
+  using LockProfiler::stats;
+};
+
+// The spinlocks from each benchmark
+using NaiveSpinlock = Spinlock<ExchangeAcquire, SpinOnAcquire, NoBackoff>;
+using LocalSpinlock = Spinlock<ExchangeAcquire, SpinLocally, NoBackoff>;
+using ActiveBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, ActiveBackoff<150>>;
+using PassiveBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, PassiveBackoff<4>>;
+using ExpBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, ExpBackoff<4, 1024>>;
+using RandomBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, RandomBackoff<4, 1024>>;
+using AdaptiveBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, AdaptiveBackoff<4, 1024>>;
+using TimedBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, TimedBackoff<100, 25600>>;
+using MonitorSpinlock =
+    Spinlock<ExchangeAcquire, MonitorWait, TimedBackoff<100, 25600>>;
+
+// The same spinlocks with the minimum memory orderings (unlock is a plain
+// store instead of an xchg)
+using AcqRelLocalSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, NoBackoff, AcqRelOrdering>;
+using AcqRelExpBackoffSpinlock =
+    Spinlock<ExchangeAcquire, SpinLocally, ExpBackoff<4, 1024>, AcqRelOrdering>;
+
+}  // namespace spinlocks
@@ -0,0 +1,180 @@
+// This header contains the lock contention profiler
+// Compiled in only when SPINLOCKS_STATS is defined (e.g., -DSPINLOCKS_STATS)
+// Otherwise every hook is empty and the profiler takes no space
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <cstdint>
+
+#include "histogram.h"
+
+#ifdef SPINLOCKS_STATS
+#include <x86intrin.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cache_line.h"
+#endif
+
+namespace spinlocks {
+
+// Snapshot of a lock's counters (merged across threads)
+struct LockStats {
+  // Number of times the lock was acquired
+  std::uint64_t acquisitions = 0;
+  // Attempts to grab the lock that failed (e.g., exchange returned true)
+  std::uint64_t failed_attempts = 0;
+  // Iterations spent in backoff
+  std::uint64_t pause_iters = 0;
+  // Cycles the lock was held (rdtsc)
+  std::uint64_t hold_cycles = 0;
+  // Cycles from calling lock() to getting the lock (rdtsc)
+  Histogram wait_cycles;
+};
+
+#ifdef SPINLOCKS_STATS
+
+// Profiler that counts per thread and merges on read
+// Each thread writes its own padded counters, so profiling doesn't add any
+// shared cache line traffic to the lock
+// Padded so the holder's bookkeeping never shares a line with the lock word
+class alignas(kCacheLineSize) LockProfiler {
+ private:
+  // Counter written by one thread and read by any thread
+  class Counter {
+   private:
+    std::atomic<std::uint64_t> v{0};
+
+   public:
+    void add(std::uint64_t n) {
+      auto old = v.load(std::memory_order_relaxed);
+      v.store(old + n, std::memory_order_relaxed);
+    }
+    void set(std::uint64_t n) { v.store(n, std::memory_order_relaxed); }
+    std::uint64_t get() const { return v.load(std::memory_order_relaxed); }
+  };
+
+  // Counters for one thread using this lock
+  struct alignas(kCacheLineSize) ThreadStats {
+    Counter acquisitions;
+    Counter failed_attempts;
+    Counter pause_iters;
+    Counter hold_cycles;
+    Counter max_wait;
+    Counter wait_cycles[Histogram::kBuckets];
+  };
+
+  // Each lock gets a unique id, so a thread's cached entry for a destroyed
+  // lock is never mistaken for a new lock at the same address
+  static std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> id{1};
+    return id.fetch_add(1);
+  }
+  const std::uint64_t id = next_id();
+
+  // Counters for every thread that has used the lock (freed with the lock)
+  mutable std::mutex m;
+  std::vector<std::unique_ptr<ThreadStats>> threads;
+  std::unordered_map<std::thread::id, ThreadStats *> by_thread;
+
+  // Locks each thread remembers its counters for
+  // A fixed cache, so a thread's memory doesn't grow with every lock it has
+  // ever used (benchmarks make a new lock for every run)
+  static constexpr std::size_t kCachedLocks = 16;
+
+  // Only touched by the thread holding the lock
+  ThreadStats *holder = nullptr;
+  std::uint64_t acquired_at = 0;
+
+  // Counters for the calling thread (registered the first time)
+  ThreadStats &local() {
+    // Most threads keep using the same few locks, so check the cache first
+    struct Cached {
+      std::uint64_t id = 0;
+      ThreadStats *stats = nullptr;
+    };
+    thread_local Cached cache[kCachedLocks];
+    auto &c = cache[id % kCachedLocks];
+    if (c.id == id) return *c.stats;
+
+    // Otherwise look ourselves up in the lock's registry
+    std::lock_guard<std::mutex> g(m);
+    auto &entry = by_thread[std::this_thread::get_id()];
+    if (entry == nullptr) {
+      threads.push_back(std::make_unique<ThreadStats>());
+      entry = threads.back().get();
+    }
+    c.id = id;
+    c.stats = entry;
+    return *entry;
+  }
+
+ public:
+  // Called when lock() starts (returns the start time)
+  std::uint64_t profile_start() { return __rdtsc(); }
+
+  // Called once we hold the lock
+  void profile_acquired(std::uint64_t start, std::uint64_t failed_attempts,
+                        std::uint64_t pause_iters) {
+    auto now = __rdtsc();
+    auto wait = now - start;
+
+    auto &t = local();
+    t.acquisitions.add(1);
+    t.failed_attempts.add(failed_attempts);
+    t.pause_iters.add(pause_iters);
+    t.wait_cycles[Histogram::bucket(wait)].add(1);
+    if (wait > t.max_wait.get()) t.max_wait.set(wait);
+
+    holder = &t;
+    acquired_at = now;
+  }
+
+  // Called right before we release the lock
+  void profile_released() {
+    holder->hold_cycles.add(__rdtsc() - acquired_at);
+  }
+
+  // Merge every thread's counters
+  LockStats stats() const {
+    LockStats s;
+    std::lock_guard<std::mutex> g(m);
+    for (auto &t : threads) {
+      s.acquisitions += t->acquisitions.get();
+      s.failed_attempts += t->failed_attempts.get();
+      s.pause_iters += t->pause_iters.get();
+      s.hold_cycles += t->hold_cycles.get();
+
+      Histogram h;
+      for (int b = 0; b < Histogram::kBuckets; b++) {
+        auto n = t->wait_cycles[b].get();
+        if (n != 0) h.add(b, n, 0);
+      }
+      h.add(0, 0, t->max_wait.get());
+      s.wait_cycles.merge(h);
+    }
+    return s;
+  }
+};
+
+#else
+
+// Profiling is compiled out (every hook does nothing)
+class LockProfiler {
+ public:
+  std::uint64_t profile_start() { return 0; }
+  void profile_acquired(std::uint64_t, std::uint64_t, std::uint64_t) {}
+  void profile_released() {}
+  LockStats stats() const { return {}; }
+};
+
+#endif
+
+}  // namespace spinlocks
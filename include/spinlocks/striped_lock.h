@@ -0,0 +1,163 @@
+// This header contains the striped (sharded) lock table
+// Optimizations:
+//  1.) Keys are spread over many locks, so unrelated keys don't contend
+//  2.) Each stripe gets its own cache line (no false sharing between locks)
+//  3.) Power-of-two stripe count (picking a stripe is a multiply and a mask)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+#include "cache_line.h"
+#include "spinlock.h"
+
+namespace spinlocks {
+
+// How a stripe's lock is held
+// Most locks are just lock()/unlock(), but queue locks (e.g., MCSLock) take
+// a node for each acquisition, which has to live until we unlock
+template <typename Lock, typename = void>
+struct StripeHold {
+  void lock(Lock &l) { l.lock(); }
+  void unlock(Lock &l) { l.unlock(); }
+};
+template <typename Lock>
+struct StripeHold<Lock, std::void_t<typename Lock::Node>> {
+  typename Lock::Node node;
+  void lock(Lock &l) { l.lock(node); }
+  void unlock(Lock &l) { l.unlock(node); }
+};
+
+// Striped Lock
+// Maps each key to one of num_stripes locks (rounded up to a power of two)
+// Locks that need a node (e.g., MCSLock) are used through the guards, and
+// locks with plain lock()/unlock() can also be used by key directly
+template <typename Lock = ExpBackoffSpinlock>
+class StripedLock {
+ private:
+  // Each lock gets its own cache line
+  struct alignas(kCacheLineSize) Stripe {
+    Lock lock;
+  };
+
+  std::unique_ptr<Stripe[]> stripes;
+  std::size_t mask;
+
+  // Round up to the next power of two
+  static std::size_t stripe_count(std::size_t n) {
+    std::size_t count = 1;
+    while (count < n) count <<= 1;
+    return count;
+  }
+
+ public:
+  explicit StripedLock(std::size_t num_stripes = 64)
+      : stripes(new Stripe[stripe_count(num_stripes)]),
+        mask(stripe_count(num_stripes) - 1) {}
+
+  std::size_t size() const { return mask + 1; }
+
+  // Stripe a key maps to
+  // std::hash is often the identity for integers, so we mix the bits
+  // (Fibonacci hashing) before taking the stripe from the high bits
+  template <typename Key>
+  std::size_t stripe(const Key &key) const {
+    std::uint64_t h = std::hash<Key>{}(key);
+    return ((h * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+  }
+
+  // Lock for a stripe
+  Lock &stripe_lock(std::size_t i) { return stripes[i].lock; }
+
+  // Locking mechanism (for locks that don't need a node)
+  template <typename Key>
+  void lock(const Key &key) {
+    stripe_lock(stripe(key)).lock();
+  }
+
+  // Unlocking mechanism (for locks that don't need a node)
+  template <typename Key>
+  void unlock(const Key &key) {
+    stripe_lock(stripe(key)).unlock();
+  }
+
+  // Holds the stripe for one key for the current scope
+  class Guard {
+   private:
+    Lock &l;
+    StripeHold<Lock> hold;
+
+   public:
+    template <typename Key>
+    Guard(StripedLock &table, const Key &key)
+        : l(table.stripe_lock(table.stripe(key))) {
+      hold.lock(l);
+    }
+    ~Guard() { hold.unlock(l); }
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+  };
+
+  // Holds the stripes for several keys for the current scope
+  // Stripes are locked in increasing order (so two threads locking
+  // overlapping keys can never deadlock), and a stripe shared by several
+  // keys is only locked once
+  // Up to kInlineKeys keys are kept on the stack (no heap allocation)
+  class MultiGuard {
+   public:
+    static constexpr std::size_t kInlineKeys = 4;
+
+   private:
+    StripedLock &table;
+    std::size_t count = 0;
+    std::size_t *held;
+    StripeHold<Lock> *holds;
+
+    std::size_t inline_held[kInlineKeys];
+    StripeHold<Lock> inline_holds[kInlineKeys];
+    std::unique_ptr<std::size_t[]> heap_held;
+    std::unique_ptr<StripeHold<Lock>[]> heap_holds;
+
+   public:
+    template <typename Key>
+    MultiGuard(StripedLock &table, std::initializer_list<Key> keys)
+        : MultiGuard(table, keys.begin(), keys.end()) {}
+
+    template <typename It>
+    MultiGuard(StripedLock &table, It first, It last)
+        : table(table), held(inline_held), holds(inline_holds) {
+      auto n = static_cast<std::size_t>(std::distance(first, last));
+      if (n > kInlineKeys) {
+        heap_held.reset(new std::size_t[n]);
+        heap_holds.reset(new StripeHold<Lock>[n]);
+        held = heap_held.get();
+        holds = heap_holds.get();
+      }
+
+      for (; first != last; ++first) held[count++] = table.stripe(*first);
+      std::sort(held, held + count);
+      count = std::unique(held, held + count) - held;
+
+      for (std::size_t i = 0; i < count; i++)
+        holds[i].lock(table.stripe_lock(held[i]));
+    }
+
+    // Unlock in the opposite order
+    ~MultiGuard() {
+      for (auto i = count; i-- > 0;)
+        holds[i].unlock(table.stripe_lock(held[i]));
+    }
+    MultiGuard(const MultiGuard &) = delete;
+    MultiGuard &operator=(const MultiGuard &) = delete;
+  };
+};
+
+}  // namespace spinlocks
@@ -0,0 +1,121 @@
+// This header contains the ticket-based spinlock
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "deadline.h"
+
+namespace spinlocks {
+
+// Simple Spinlock
+// Now uses ticket system for fairness
+class TicketLock : public TimedLockable<TicketLock> {
+ private:
+  // Lock is now two counters:
+  //  1.) The latest place taken in line
+  //  2.) Which number is currently being served
+  std::atomic<std::uint16_t> line{0};
+  // Needs to avoid the compiler putting this in a register!
+  volatile std::uint16_t serving{0};
+
+ public:
+  // Locking mechanism
+  void lock() {
+    // Get the latest place in line (and increment the value)
+    auto place = line.fetch_add(1);
+
+    // Wait until our number is "called"
+    while (serving != place)
+      ;
+  }
+
+  // Take a place in line only if it would be served right away
+  bool try_lock() {
+    std::uint16_t now = serving;
+    std::uint16_t expected = now;
+    return line.compare_exchange_strong(expected, now + 1);
+  }
+
+  // Keep trying until the deadline
+  // Once we take a place in line we can't leave it, so we only ever try_lock
+  bool try_lock_until(const Deadline &deadline) {
+    return try_lock_until_deadline(*this, deadline);
+  }
+  using TimedLockable<TicketLock>::try_lock_until;
+
+  // Unlocking mechanism
+  // Increment serving number to pass the lock
+  // No need for an atomic! The thread with the lock is the only one that
+  // accesses this variable!
+  void unlock() {
+    asm volatile("" : : : "memory");
+    serving = serving + 1;
+  }
+};
+
+// Ticket lock with proportional backoff
+// Optimizations:
+//  1.) Acquire/release atomics on serving (no volatile or compiler barrier)
+//  2.) 32-bit counters (wraparound would need 2^32 waiters at once)
+//  3.) Waiters pause in proportion to their distance from the front of the
+//      line, so waiters at the back stop hammering the cache line
+template <int PauseItersPerWaiter = 50>
+class ProportionalTicketLock
+    : public TimedLockable<ProportionalTicketLock<PauseItersPerWaiter>> {
+ private:
+  // Lock is two counters:
+  //  1.) The latest place taken in line
+  //  2.) Which number is currently being served
+  std::atomic<std::uint32_t> line{0};
+  std::atomic<std::uint32_t> serving{0};
+
+ public:
+  // Locking mechanism
+  void lock() {
+    // Get the latest place in line (and increment the value)
+    auto place = line.fetch_add(1, std::memory_order_relaxed);
+
+    // Wait until our number is "called"
+    while (1) {
+      auto now = serving.load(std::memory_order_acquire);
+      if (now == place) return;
+
+      // Pause for longer the further back in line we are
+      // Unsigned subtraction still works after the counters wrap around
+      auto waiters_ahead = place - now;
+      for (std::uint32_t i = 0; i < PauseItersPerWaiter * waiters_ahead; i++)
+        _mm_pause();
+    }
+  }
+
+  // Take a place in line only if it would be served right away
+  bool try_lock() {
+    auto now = serving.load(std::memory_order_acquire);
+    auto expected = now;
+    return line.compare_exchange_strong(expected, now + 1,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed);
+  }
+
+  // Keep trying until the deadline
+  // Once we take a place in line we can't leave it, so we only ever try_lock
+  bool try_lock_until(const Deadline &deadline) {
+    return try_lock_until_deadline(*this, deadline);
+  }
+  using TimedLockable<ProportionalTicketLock>::try_lock_until;
+
+  // Unlocking mechanism
+  // Only the thread with the lock writes serving, so we don't need an atomic
+  // increment, just a release store so the next thread sees our writes
+  void unlock() {
+    auto now = serving.load(std::memory_order_relaxed);
+    serving.store(now + 1, std::memory_order_release);
+  }
+};
+
+}  // namespace spinlocks
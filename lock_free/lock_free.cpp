@@ -3,42 +3,10 @@
 
 #include <benchmark/benchmark.h>
 
-#include <atomic>
-#include <cstdint>
-#include <thread>
-#include <vector>
-
-// Increment val 100k times
-void inc(std::atomic<int64_t> &val) {
-  for (int i = 0; i < 100000; i++) val++;
-}
+#include "../bench/harness.h"
 
 // Small Benchmark
-static void atomic(benchmark::State &s) {
-  // Sweep over a range of threads
-  auto num_threads = s.range(0);
-
-  // Value we will increment
-  std::atomic<std::int64_t> val{0};
-
-  // Allocate a vector of threads
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-
-  // Timing loop
-  for (auto _ : s) {
-    for (auto i = 0u; i < num_threads; i++) {
-      threads.emplace_back([&] { inc(val); });
-    }
-    // Join threads
-    for (auto &thread : threads) thread.join();
-    threads.clear();
-  }
-}
-BENCHMARK(atomic)
-    ->RangeMultiplier(2)
-    ->Range(1, std::thread::hardware_concurrency())
-    ->UseRealTime()
-    ->Unit(benchmark::kMillisecond);
+static void atomic(benchmark::State &s) { bench::atomic_benchmark(s); }
+BENCHMARK(atomic)->Apply(bench::thread_sweep);
 
 BENCHMARK_MAIN();
@@ -0,0 +1,26 @@
+// This program benchmarks an MCS queue lock in C++
+// Optimizations:
+//  1.) Ticket-style fairness (FIFO queue)
+//  2.) Each waiter spins on its own cache line
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/mcs_lock.h"
+
+// Queue lock
+// Each waiter spins locally on its own node
+using Spinlock = spinlocks::MCSLock;
+
+// Small Benchmark
+static void mcs_lock(benchmark::State &s) {
+  bench::lock_benchmark<Spinlock>(s);
+}
+BENCHMARK(mcs_lock)->Apply(bench::thread_sweep);
+
+// Workload Benchmark
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, Spinlock)->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,96 @@
+// This program checks and benchmarks the memory orderings of our locks in
+// C++
+// Every thread runs the same non-atomic increment as every other benchmark,
+// and we check that no increment was lost. The critical section also keeps
+// two plain values in step, litmus-style: if a critical section ever ran
+// before the last one finished (or saw only some of its writes), they would
+// differ
+// Threads go up to 4 per core, so holders get preempted mid critical section
+// (FIFO locks only go up to one per core, see below)
+// Build with -fsanitize=thread to have ThreadSanitizer check every ordering
+// too (a missing acquire or release shows up as a data race on the values)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/clh_lock.h"
+#include "../include/spinlocks/futex_lock.h"
+#include "../include/spinlocks/mcs_lock.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Values the critical section writes (plain, non-atomic memory)
+struct Shared {
+  std::int64_t val = 0;
+  // Always equal to val outside of a critical section
+  std::int64_t shadow = 0;
+  // Critical sections that saw shadow out of step with val
+  std::int64_t torn = 0;
+};
+
+// Increment val kIncrements times, checking shadow each time
+template <typename Lock>
+void checked_inc(Lock &s, Shared &data) {
+  for (int i = 0; i < bench::kIncrements; i++) {
+    bench::locked(s, [&] {
+      data.torn += data.shadow != data.val;
+      data.val++;
+      data.shadow = data.val;
+    });
+  }
+}
+
+// Small Benchmark (use with oversubscribed_sweep)
+// Fails the run if an increment was lost or a critical section was torn
+template <typename Lock>
+static void exclusive_inc(benchmark::State &s) {
+  Shared data;
+
+  Lock sl;
+  bench::run_pool(s, [&](int) { checked_inc(sl, data); });
+
+  // What we should have ended up with
+  std::int64_t expected = s.iterations() * s.range(0) * bench::kIncrements;
+  std::int64_t lost = expected - data.val;
+  s.counters["lost_updates"] = lost;
+  s.counters["torn"] = data.torn;
+  if (lost != 0 || data.torn != 0)
+    s.SkipWithError(("mutual exclusion violated: " + std::to_string(lost) +
+                     " lost updates, " + std::to_string(data.torn) +
+                     " torn critical sections")
+                        .c_str());
+}
+
+// Each lock with its default (sequentially consistent) and minimum orderings
+// (and the futex lock, which parks instead of spinning)
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::LocalSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::AcqRelLocalSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::AcqRelExpBackoffSpinlock)
+    ->Apply(bench::oversubscribed_sweep);
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::FutexLock<>)
+    ->Apply(bench::oversubscribed_sweep);
+
+// FIFO locks (queue and ticket locks) only go up to one thread per core
+// Past that they hit a preemption convoy: the lock can only go to the next
+// thread in line, so every handoff waits for a descheduled waiter to get
+// its next timeslice, and a single run can take minutes
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::MCSLock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::AcqRelMCSLock)
+    ->Apply(bench::pool_sweep);
+
+// Our other FIFO locks (these already use acquire/release atomics)
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::ProportionalTicketLock<>)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(exclusive_inc, spinlocks::AbortableCLHLock)
+    ->Apply(bench::pool_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,38 @@
+// This program benchmarks an improved spinlock C++
+// Optimizations:
+//  1.) Spin locally
+//  2.) Backoff
+//  3.) Exponential backoff with a window learned at runtime
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/spinlock.h"
+
+// Simple Spinlock
+// Lock now performs local spinning
+// Lock now tunes its own exponential backoff
+using Spinlock = spinlocks::AdaptiveBackoffSpinlock;
+
+// Small Benchmark
+// Also reports the window the lock settled on
+static void adaptive_backoff(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+
+  Spinlock sl;
+  bench::run_pool(s, [&](int) { bench::inc(sl, val); });
+
+  s.counters["min_iters"] = sl.backoff_state().min();
+  s.counters["max_iters"] = sl.backoff_state().max();
+}
+BENCHMARK(adaptive_backoff)->Apply(bench::pool_sweep);
+
+// Workload Benchmark
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, Spinlock)->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
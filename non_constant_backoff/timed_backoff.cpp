@@ -0,0 +1,51 @@
+// This program benchmarks an improved spinlock C++
+// Optimizations:
+//  1.) Spin locally
+//  2.) Backoff
+//  3.) Add exponential backoff
+//  4.) Backoff is in nanoseconds (pause is calibrated before timing)
+//  5.) tpause and umonitor/umwait on CPUs with WAITPKG
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/pause.h"
+#include "../include/spinlocks/spinlock.h"
+
+// Report what we measured about this machine
+static void report_calibration(benchmark::State &s) {
+  auto &c = spinlocks::pause_calibration();
+  s.counters["tsc_per_ns"] = c.tsc_per_ns;
+  s.counters["tsc_per_pause"] = c.tsc_per_pause;
+  s.counters["waitpkg"] = spinlocks::waitpkg_supported();
+}
+
+// Small Benchmark
+template <typename Lock>
+static void timed_backoff(benchmark::State &s) {
+  bench::pooled_lock_benchmark<Lock>(s);
+  report_calibration(s);
+}
+
+// Iteration-based backoff (tuned on one machine)
+BENCHMARK_TEMPLATE(timed_backoff, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::pool_sweep);
+
+// Nanosecond-based backoff (same window on every machine)
+BENCHMARK_TEMPLATE(timed_backoff, spinlocks::TimedBackoffSpinlock)
+    ->Apply(bench::pool_sweep);
+
+// Sleep on the lock word (WAITPKG), or fall back to timed backoff
+BENCHMARK_TEMPLATE(timed_backoff, spinlocks::MonitorSpinlock)
+    ->Apply(bench::pool_sweep);
+
+// Workload Benchmark
+// Both nanosecond-based locks under each contention profile
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::TimedBackoffSpinlock)
+    ->Apply(bench::workload_sweep);
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::MonitorSpinlock)
+    ->Apply(bench::workload_sweep);
+
+BENCHMARK_MAIN();
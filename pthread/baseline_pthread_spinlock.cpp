@@ -2,51 +2,18 @@
 // By: Nick from CoffeeBeforeArch
 
 #include <benchmark/benchmark.h>
-#include <pthread.h>
 
-#include <atomic>
-#include <cstdint>
-#include <thread>
+#include "../bench/harness.h"
 
-// Increment val once each time the lock is acquired
-void inc(pthread_spinlock_t &sl, std::int64_t &val) {
-  for (int i = 0; i < 100000; i++) {
-    pthread_spin_lock(&sl);
-    val++;
-    pthread_spin_unlock(&sl);
-  }
-}
-
-// Benchmark Small
+// Small Benchmark
 static void pthread_spinlock(benchmark::State &s) {
-  // Sweep over a range of threads
-  auto num_threads = s.range(0);
-
-  // Value we will increment
-  std::int64_t val = 0;
-
-  // Allocate a vector of threads
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-
-  // Create a spinlock
-  pthread_spinlock_t sl;
-  pthread_spin_init(&sl, PTHREAD_PROCESS_PRIVATE);
-
-  // Timing loop
-  for (auto _ : s) {
-    for (auto i = 0u; i < num_threads; i++) {
-      threads.emplace_back([&] { inc(sl, val); });
-    }
-    // Join threads
-    for (auto &thread : threads) thread.join();
-    threads.clear();
-  }
+  bench::lock_benchmark<bench::PthreadSpinlock>(s);
 }
-BENCHMARK(pthread_spinlock)
-    ->RangeMultiplier(2)
-    ->Range(1, std::thread::hardware_concurrency())
-    ->UseRealTime()
-    ->Unit(benchmark::kMillisecond);
+BENCHMARK(pthread_spinlock)->Apply(bench::thread_sweep);
+
+// Workload Benchmark
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, bench::PthreadSpinlock)
+    ->Apply(bench::workload_sweep);
 
 BENCHMARK_MAIN();
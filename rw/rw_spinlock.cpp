@@ -0,0 +1,118 @@
+// This program benchmarks reader-writer spinlocks in C++
+// Optimizations:
+//  1.) Readers share the lock
+//  2.) Writer preference (waiting writers block new readers)
+//  3.) Per-thread reader slots (scalable version)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <shared_mutex>
+#include <thread>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/rw_spinlock.h"
+#include "../include/spinlocks/spinlock.h"
+
+using bench::rw_benchmark;
+
+// Exclusive baseline (readers serialize)
+BENCHMARK_TEMPLATE(rw_benchmark, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::rw_sweep);
+
+// Reader-writer locks
+BENCHMARK_TEMPLATE(rw_benchmark, spinlocks::RWSpinlock<>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(rw_benchmark, spinlocks::ScalableRWSpinlock<>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(rw_benchmark, std::shared_mutex)->Apply(bench::rw_sweep);
+
+// Number of times each writer takes the lock while readers keep coming
+constexpr int kWrites = 1000;
+
+// How long readers keep coming before we call a writer starved
+constexpr auto kStarvationLimit = std::chrono::seconds(2);
+
+// Writer preference check (use with writer_sweep)
+// Threads 0 and 1 take the lock kWrites times each, and every other thread
+// keeps taking it shared (yielding while it holds the lock, so readers
+// overlap and the lock is never free of readers) until both writers are
+// done. Two writers, so one writer getting the lock can't let readers past
+// the other. Fails the run if a writer doesn't finish before the limit
+template <typename Lock>
+static void writer_starvation(benchmark::State &s) {
+  using clock = std::chrono::steady_clock;
+  constexpr int kWriters = 2;
+  int num_readers = static_cast<int>(s.range(0)) - kWriters;
+
+  // Value we will read or increment
+  std::int64_t val = 0;
+  std::atomic<bool> starved{false};
+
+  Lock sl;
+  bench::WorkerPool pool(static_cast<int>(s.range(0)));
+  for (auto _ : s) {
+    std::atomic<int> writers_done{0};
+    std::atomic<int> readers_in{0};
+    auto give_up = clock::now() + kStarvationLimit;
+    s.SetIterationTime(pool.run([&](int tid) {
+      if (tid < kWriters) {
+        // Start once every reader is in the stream
+        while (readers_in.load() != num_readers) std::this_thread::yield();
+        for (int i = 0; i < kWrites; i++) {
+          sl.lock();
+          val++;
+          sl.unlock();
+        }
+        if (clock::now() > give_up) starved.store(true);
+        writers_done.fetch_add(1);
+        return;
+      }
+
+      bool counted = false;
+      while (writers_done.load(std::memory_order_relaxed) != kWriters &&
+             clock::now() < give_up) {
+        sl.lock_shared();
+        if (!counted) {
+          readers_in.fetch_add(1);
+          counted = true;
+        }
+        benchmark::DoNotOptimize(val);
+        bench::work(200);
+        // Let other readers in while we hold the lock (even on one core)
+        std::this_thread::yield();
+        sl.unlock_shared();
+      }
+      if (!counted) readers_in.fetch_add(1);
+    }));
+    if (starved.load()) break;
+  }
+
+  if (starved.load()) {
+    s.SkipWithError("writer starved by readers");
+    return;
+  }
+  s.counters["time_per_write"] = benchmark::Counter(
+      kWriters * kWrites, benchmark::Counter::kIsIterationInvariantRate |
+                              benchmark::Counter::kInvert);
+}
+
+// Two writers and at least two readers
+static void writer_sweep(benchmark::internal::Benchmark *b) {
+  b->RangeMultiplier(2)
+      ->Range(4, std::max(4u, 2 * std::thread::hardware_concurrency()))
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+// std::shared_mutex is left out (glibc prefers readers by default)
+BENCHMARK_TEMPLATE(writer_starvation, spinlocks::RWSpinlock<>)
+    ->Apply(writer_sweep);
+BENCHMARK_TEMPLATE(writer_starvation, spinlocks::ScalableRWSpinlock<>)
+    ->Apply(writer_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+// This program benchmarks a sequence lock (seqlock) in C++
+// Optimizations:
+//  1.) Readers only read shared memory (the sequence number and the data)
+//  2.) Readers retry when a write overlaps instead of blocking
+// Every thread copies a small config struct (or, sometimes, writes a new
+// one), and we compare against our reader-writer spinlocks
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/rw_spinlock.h"
+#include "../include/spinlocks/seqlock.h"
+#include "../include/spinlocks/spinlock.h"
+
+// Small config struct (every field is the same in a consistent copy)
+struct Config {
+  std::uint64_t fields[6] = {};
+};
+
+// Config protected by a (reader-writer) lock, with the same interface as
+// Seqlocked
+template <typename Lock>
+class LockedConfig {
+ private:
+  mutable Lock l;
+  Config config;
+
+ public:
+  Config load() const {
+    if constexpr (bench::has_shared<Lock>::value) {
+      l.lock_shared();
+      Config c = config;
+      l.unlock_shared();
+      return c;
+    } else {
+      l.lock();
+      Config c = config;
+      l.unlock();
+      return c;
+    }
+  }
+
+  void store(const Config &c) {
+    l.lock();
+    config = c;
+    l.unlock();
+  }
+};
+
+// Read the config (read_pct% of the time) or write a new one
+// Returns the number of reads that saw a torn (inconsistent) copy
+template <typename Store>
+std::int64_t read_or_write(Store &store, int read_pct, int tid) {
+  // Each thread gets its own generator (seeded by thread for repeatable runs)
+  std::minstd_rand rng(tid + 1);
+  std::int64_t torn = 0;
+  for (int i = 0; i < bench::kIncrements; i++) {
+    if (static_cast<int>(rng() % 100) < read_pct) {
+      auto c = store.load();
+      for (auto f : c.fields) torn += f != c.fields[0];
+    } else {
+      Config c;
+      for (auto &f : c.fields) f = i;
+      store.store(c);
+    }
+  }
+  return torn;
+}
+
+// Small Benchmark (use with rw_sweep)
+template <typename Store>
+static void config_reads(benchmark::State &s) {
+  int read_pct = static_cast<int>(s.range(1));
+  std::atomic<std::int64_t> torn{0};
+
+  Store store;
+  bench::run_pool(s, [&](int tid) {
+    torn.fetch_add(read_or_write(store, read_pct, tid));
+  });
+
+  // Should always be 0
+  s.counters["torn_reads"] = torn.load();
+}
+BENCHMARK_TEMPLATE(config_reads, spinlocks::Seqlocked<Config>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(config_reads, LockedConfig<spinlocks::RWSpinlock<>>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(config_reads,
+                   LockedConfig<spinlocks::ScalableRWSpinlock<>>)
+    ->Apply(bench::rw_sweep);
+BENCHMARK_TEMPLATE(config_reads, LockedConfig<spinlocks::ExpBackoffSpinlock>)
+    ->Apply(bench::rw_sweep);
+
+BENCHMARK_MAIN();
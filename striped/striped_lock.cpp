@@ -0,0 +1,126 @@
+// This program benchmarks a striped (sharded) lock table in C++
+// Optimizations:
+//  1.) Keys are spread over many cache-line-padded locks
+//  2.) Multi-key operations lock stripes in sorted order (no deadlock)
+// Keys follow a Zipfian distribution (a few keys are very hot), and we
+// sweep the number of stripes
+// Every value gets its own cache line, so keys on different stripes never
+// falsely share data (only lock contention changes with the stripe count)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/cache_line.h"
+#include "../include/spinlocks/mcs_lock.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/striped_lock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Number of keys in the table
+constexpr int kNumKeys = 1 << 16;
+
+// One key's value (on its own cache line)
+struct alignas(spinlocks::kCacheLineSize) Value {
+  std::int64_t value = 0;
+};
+
+// Zipfian key generator
+// Key k is picked with probability proportional to 1 / (k + 1)^theta
+// theta = 0.99 is the skew YCSB uses
+class Zipfian {
+ private:
+  // Probability of picking a key at or below each key
+  std::vector<double> cdf;
+
+ public:
+  Zipfian(int num_keys, double theta) : cdf(num_keys) {
+    double sum = 0;
+    for (int k = 0; k < num_keys; k++) {
+      sum += 1.0 / std::pow(k + 1, theta);
+      cdf[k] = sum;
+    }
+    for (auto &p : cdf) p /= sum;
+  }
+
+  template <typename Rng>
+  std::uint64_t operator()(Rng &rng) const {
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    auto it = std::lower_bound(cdf.begin(), cdf.end(), u);
+    return std::min<std::uint64_t>(it - cdf.begin(), cdf.size() - 1);
+  }
+};
+
+// Keys each thread will use (made before timing, so we only time the locks)
+std::vector<std::vector<std::uint64_t>> zipfian_keys(int num_threads) {
+  static const Zipfian zipf(kNumKeys, 0.99);
+  std::vector<std::vector<std::uint64_t>> keys(num_threads);
+  for (int t = 0; t < num_threads; t++) {
+    // Each thread gets its own generator (seeded by thread for repeatable
+    // runs)
+    std::mt19937_64 rng(t + 1);
+    keys[t].resize(bench::kIncrements);
+    for (auto &k : keys[t]) k = zipf(rng);
+  }
+  return keys;
+}
+
+// Increment one key's value under its stripe
+template <typename Lock>
+static void striped_inc(benchmark::State &s) {
+  auto keys = zipfian_keys(static_cast<int>(s.range(0)));
+  std::vector<Value> values(kNumKeys);
+
+  spinlocks::StripedLock<Lock> table(s.range(1));
+  bench::run_pool(s, [&](int tid) {
+    for (auto key : keys[tid]) {
+      typename spinlocks::StripedLock<Lock>::Guard g(table, key);
+      values[key].value++;
+    }
+  });
+}
+
+// Move one unit between two keys (locks both stripes)
+template <typename Lock>
+static void striped_transfer(benchmark::State &s) {
+  auto keys = zipfian_keys(static_cast<int>(s.range(0)));
+  std::vector<Value> values(kNumKeys);
+
+  spinlocks::StripedLock<Lock> table(s.range(1));
+  bench::run_pool(s, [&](int tid) {
+    auto &k = keys[tid];
+    for (std::size_t i = 0; i < k.size(); i++) {
+      // Pair each key with the next one the thread will use
+      auto from = k[i];
+      auto to = k[(i + 1) % k.size()];
+      typename spinlocks::StripedLock<Lock>::MultiGuard g(table, {from, to});
+      values[from].value--;
+      values[to].value++;
+    }
+  });
+}
+
+// Thread sweep crossed with the number of stripes
+static void stripe_sweep(benchmark::internal::Benchmark *b) {
+  b->ArgsProduct({benchmark::CreateRange(
+                      1, std::thread::hardware_concurrency(), 2),
+                  {1, 4, 16, 64, 256, 1024}})
+      ->ArgNames({"threads", "stripes"})
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(striped_inc, spinlocks::ExpBackoffSpinlock)
+    ->Apply(stripe_sweep);
+BENCHMARK_TEMPLATE(striped_inc, spinlocks::TicketLock)->Apply(stripe_sweep);
+BENCHMARK_TEMPLATE(striped_inc, spinlocks::MCSLock)->Apply(stripe_sweep);
+BENCHMARK_TEMPLATE(striped_transfer, spinlocks::ExpBackoffSpinlock)
+    ->Apply(stripe_sweep);
+
+BENCHMARK_MAIN();
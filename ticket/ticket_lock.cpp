@@ -5,80 +5,42 @@
 
 #include <benchmark/benchmark.h>
 
-#include <atomic>
-#include <cstdint>
-#include <thread>
-#include <vector>
+#include "../bench/harness.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
 
 // Simple Spinlock
 // Now uses ticket system for fairness
-class Spinlock {
- private:
-  // Lock is now two counters:
-  //  1.) The latest place taken in line
-  //  2.) Which number is currently being served
-  std::atomic<std::uint16_t> line{0};
-  // Needs to avoid the compiler putting this in a register!
-  volatile std::uint16_t serving{0};
-
- public:
-  // Locking mechanism
-  void lock() {
-    // Get the latest place in line (and increment the value)
-    auto place = line.fetch_add(1);
-
-    // Wait until our number is "called"
-    while (serving != place)
-      ;
-  }
-
-  // Unlocking mechanism
-  // Increment serving number to pass the lock
-  // No need for an atomic! The thread with the lock is the only one that
-  // accesses this variable!
-  void unlock() {
-    asm volatile("" : : : "memory");
-    serving = serving + 1;
-  }
-};
-
-// Increment val once each time the lock is acquired
-void inc(Spinlock &s, std::int64_t &val) {
-  for (int i = 0; i < 100000; i++) {
-    s.lock();
-    val++;
-    s.unlock();
-  }
-}
+using Spinlock = spinlocks::TicketLock;
 
 // Small Benchmark
 static void ticket_lock(benchmark::State &s) {
-  // Sweep over a range of threads
-  auto num_threads = s.range(0);
-
-  // Value we will increment
-  std::int64_t val = 0;
-
-  // Allocate a vector of threads
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-
-  Spinlock sl;
+  bench::lock_benchmark<Spinlock>(s);
+}
+BENCHMARK(ticket_lock)->Apply(bench::thread_sweep);
 
-  // Timing loop
-  for (auto _ : s) {
-    for (auto i = 0u; i < num_threads; i++) {
-      threads.emplace_back([&] { inc(sl, val); });
-    }
-    // Join threads
-    for (auto &thread : threads) thread.join();
-    threads.clear();
-  }
+// Small Benchmark
+// Atomic acquire/release, wide counters, and proportional backoff
+static void proportional_ticket_lock(benchmark::State &s) {
+  bench::lock_benchmark<spinlocks::ProportionalTicketLock<>>(s);
 }
-BENCHMARK(ticket_lock)
-    ->RangeMultiplier(2)
-    ->Range(1, std::thread::hardware_concurrency())
-    ->UseRealTime()
-    ->Unit(benchmark::kMillisecond);
+BENCHMARK(proportional_ticket_lock)->Apply(bench::thread_sweep);
+
+// Fairness check
+// Tail latency, Jain's fairness index, and the longest run by one thread for
+// the ticket locks against a test-and-set lock (which makes no promises)
+using bench::latency_benchmark;
+BENCHMARK_TEMPLATE(latency_benchmark, spinlocks::LocalSpinlock)
+    ->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(latency_benchmark, Spinlock)->Apply(bench::pool_sweep);
+BENCHMARK_TEMPLATE(latency_benchmark, spinlocks::ProportionalTicketLock<>)
+    ->Apply(bench::pool_sweep);
+
+// Workload Benchmark
+// Both ticket locks under each contention profile
+using bench::workload_benchmark;
+BENCHMARK_TEMPLATE(workload_benchmark, Spinlock)->Apply(bench::workload_sweep);
+BENCHMARK_TEMPLATE(workload_benchmark, spinlocks::ProportionalTicketLock<>)
+    ->Apply(bench::workload_sweep);
 
 BENCHMARK_MAIN();
@@ -0,0 +1,77 @@
+// This program benchmarks timed lock attempts in C++
+// Every thread tries to increment a shared value, but gives up on the lock
+// after a deadline (1us to 1ms), like a request handler shedding load
+// Optimizations:
+//  1.) Backoff never pauses past the deadline
+//  2.) Abortable queue lock (waiters that time out leave the line without
+//      blocking the waiters behind them)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/clh_lock.h"
+#include "../include/spinlocks/futex_lock.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Try to increment val kIncrements times, giving up on each one after the
+// deadline
+// Returns the number of attempts that timed out
+template <typename Lock>
+std::int64_t timed_inc(Lock &s, std::int64_t &val,
+                       std::chrono::nanoseconds deadline) {
+  std::int64_t timeouts = 0;
+  for (int i = 0; i < bench::kIncrements; i++) {
+    if (s.try_lock_for(deadline)) {
+      val++;
+      s.unlock();
+    } else {
+      timeouts++;
+    }
+  }
+  return timeouts;
+}
+
+// Small Benchmark (use with deadline_sweep)
+template <typename Lock>
+static void timed_lock(benchmark::State &s) {
+  // Value we will increment
+  std::int64_t val = 0;
+  std::chrono::nanoseconds deadline(s.range(1));
+  std::atomic<std::int64_t> timeouts{0};
+
+  Lock sl;
+  bench::run_pool(s, [&](int) { timeouts += timed_inc(sl, val, deadline); });
+
+  // Fraction of attempts that got the lock before the deadline
+  double attempts = static_cast<double>(val + timeouts.load());
+  s.counters["success_rate"] = val / attempts;
+}
+
+// Thread sweep crossed with deadlines from 1us to 1ms (in nanoseconds)
+static void deadline_sweep(benchmark::internal::Benchmark *b) {
+  b->ArgsProduct({benchmark::CreateRange(
+                      1, std::thread::hardware_concurrency(), 2),
+                  {1000, 10000, 100000, 1000000}})
+      ->ArgNames({"threads", "deadline_ns"})
+      ->UseManualTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(timed_lock, spinlocks::ExpBackoffSpinlock)
+    ->Apply(deadline_sweep);
+BENCHMARK_TEMPLATE(timed_lock, spinlocks::ProportionalTicketLock<>)
+    ->Apply(deadline_sweep);
+BENCHMARK_TEMPLATE(timed_lock, spinlocks::AbortableCLHLock)
+    ->Apply(deadline_sweep);
+BENCHMARK_TEMPLATE(timed_lock, spinlocks::FutexLock<>)
+    ->Apply(deadline_sweep);
+BENCHMARK_TEMPLATE(timed_lock, std::timed_mutex)->Apply(deadline_sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+// This program benchmarks our locks by where their threads run in C++
+// Threads are pinned by topology (SMT siblings, one last level cache, across
+// last level caches, or across sockets), and two threads play ping-pong
+// through the lock on a pair of CPUs to measure how long it takes the lock
+// to get from one core to the other
+// By default we run one pair for each distance (SMT siblings, same last
+// level cache, same package, and across packages). Set BENCH_FULL_MATRIX=1
+// to run every pair (a core-to-core latency matrix)
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <emmintrin.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../bench/harness.h"
+#include "../include/spinlocks/clh_lock.h"
+#include "../include/spinlocks/futex_lock.h"
+#include "../include/spinlocks/mcs_lock.h"
+#include "../include/spinlocks/spinlock.h"
+#include "../include/spinlocks/ticket_lock.h"
+
+// Number of times the lock goes from one thread to the other and back
+constexpr int kRounds = 10000;
+
+// Take turns with the other thread (me is 0 or 1)
+// We only take our turn when the other thread just had the lock, so every
+// turn is one handoff (taking the lock back first, before the other thread
+// gets it, is part of the handoff time)
+template <typename Lock>
+void ping_pong(Lock &s, int &turn, int me) {
+  for (int i = 0; i < kRounds;) {
+    bool took_turn = false;
+    bench::locked(s, [&] {
+      if (turn == me) {
+        turn = 1 - me;
+        took_turn = true;
+      }
+    });
+    // Not our turn yet, so give the other thread a chance to get the lock
+    if (took_turn)
+      i++;
+    else
+      _mm_pause();
+  }
+}
+
+// Small Benchmark (use with cpu_pairs)
+template <typename Lock>
+static void handoff(benchmark::State &s) {
+  int a = static_cast<int>(s.range(0));
+  int b = static_cast<int>(s.range(1));
+  if (a == b) {
+    s.SkipWithError("needs two CPUs");
+    return;
+  }
+  s.SetLabel(bench::cpu_distance(a, b));
+
+  // Whose turn it is
+  int turn = 0;
+
+  Lock sl;
+  bench::WorkerPool pool(2, {a, b});
+  for (auto _ : s) s.SetIterationTime(pool.run([&](int tid) {
+    ping_pong(sl, turn, tid);
+  }));
+
+  // Time from one thread's unlock to the other thread's acquire
+  s.counters["handoff_time"] = benchmark::Counter(
+      2 * kRounds, benchmark::Counter::kIsIterationInvariantRate |
+                       benchmark::Counter::kInvert);
+}
+
+// Did we ask for every pair of CPUs? (BENCH_FULL_MATRIX set, and not "0")
+bool full_matrix() {
+  const char *env = std::getenv("BENCH_FULL_MATRIX");
+  return env != nullptr && *env != '\0' && std::strcmp(env, "0") != 0;
+}
+
+// Pairs of CPUs to run
+// Every pair once with BENCH_FULL_MATRIX (n * (n - 1) / 2 pairs per lock).
+// Otherwise the first CPU paired with the first CPU at each distance from it
+static void cpu_pairs(benchmark::internal::Benchmark *b) {
+  auto &cpus = bench::cpu_topology();
+  if (full_matrix()) {
+    for (std::size_t i = 0; i < cpus.size(); i++)
+      for (std::size_t j = i + 1; j < cpus.size(); j++)
+        b->Args({cpus[i].cpu, cpus[j].cpu});
+  } else {
+    for (std::string distance : {"smt", "llc", "package", "remote"}) {
+      for (std::size_t j = 1; j < cpus.size(); j++) {
+        if (bench::cpu_distance(cpus[0].cpu, cpus[j].cpu) == distance) {
+          b->Args({cpus[0].cpu, cpus[j].cpu});
+          break;
+        }
+      }
+    }
+  }
+  // Run (and skip) once on a machine with a single CPU
+  if (cpus.size() < 2) b->Args({0, 0});
+  b->ArgNames({"cpu_a", "cpu_b"})
+      ->UseManualTime()
+      ->Unit(benchmark::kMicrosecond);
+}
+
+using bench::placed_lock_benchmark;
+
+BENCHMARK_TEMPLATE(placed_lock_benchmark, spinlocks::ExpBackoffSpinlock)
+    ->Apply(bench::placement_sweep);
+BENCHMARK_TEMPLATE(placed_lock_benchmark, spinlocks::ProportionalTicketLock<>)
+    ->Apply(bench::placement_sweep);
+BENCHMARK_TEMPLATE(placed_lock_benchmark, spinlocks::MCSLock)
+    ->Apply(bench::placement_sweep);
+BENCHMARK_TEMPLATE(placed_lock_benchmark, spinlocks::FutexLock<>)
+    ->Apply(bench::placement_sweep);
+
+BENCHMARK_TEMPLATE(handoff, spinlocks::ExpBackoffSpinlock)->Apply(cpu_pairs);
+BENCHMARK_TEMPLATE(handoff, spinlocks::TicketLock)->Apply(cpu_pairs);
+BENCHMARK_TEMPLATE(handoff, spinlocks::ProportionalTicketLock<>)
+    ->Apply(cpu_pairs);
+BENCHMARK_TEMPLATE(handoff, spinlocks::MCSLock)->Apply(cpu_pairs);
+BENCHMARK_TEMPLATE(handoff, spinlocks::AnonymousCLHLock)->Apply(cpu_pairs);
+BENCHMARK_TEMPLATE(handoff, spinlocks::FutexLock<>)->Apply(cpu_pairs);
+
+BENCHMARK_MAIN();